@@ -0,0 +1,91 @@
+#include <fstream>
+#include <sys/stat.h>
+
+#include "CalibrationCache.hpp"
+#include "common.h"
+
+using namespace std;
+
+#define CALIBRATION_DIR     ".raxml-ng"
+#define CALIBRATION_PREFIX  "calibration."
+
+CalibrationCache::CalibrationCache() : CalibrationCache(default_fname()) {}
+
+CalibrationCache::CalibrationCache(const std::string& fname) :
+    _fname(fname), _values(), _modified(false)
+{
+}
+
+std::string CalibrationCache::default_fname()
+{
+  const char * home = getenv("HOME");
+  if (!home || !*home)
+    return "";
+
+  char hostname[256];
+  if (gethostname(hostname, sizeof(hostname)) != 0)
+    return "";
+  hostname[sizeof(hostname) - 1] = 0;
+
+  return string(home) + "/" + CALIBRATION_DIR + "/" + CALIBRATION_PREFIX + hostname;
+}
+
+double CalibrationCache::get(const std::string& key, double default_value) const
+{
+  auto it = _values.find(key);
+  return it != _values.end() ? it->second : default_value;
+}
+
+void CalibrationCache::set(const std::string& key, double value)
+{
+  _values[key] = value;
+  _modified = true;
+}
+
+bool CalibrationCache::load()
+{
+  if (_fname.empty() || !sysutil_file_exists(_fname))
+    return false;
+
+  ifstream fs(_fname);
+  string line;
+  while (getline(fs, line))
+  {
+    if (line.empty() || line[0] == '#')
+      continue;
+
+    istringstream ss(line);
+    string key;
+    double value;
+    if (ss >> key >> value)
+      _values[key] = value;
+  }
+
+  _modified = false;
+
+  return true;
+}
+
+bool CalibrationCache::save()
+{
+  if (_fname.empty())
+    return false;
+
+  /* create cache directory if needed, ignore errors here -> will fail below */
+  auto dir_end = _fname.find_last_of('/');
+  if (dir_end != string::npos)
+    mkdir(_fname.substr(0, dir_end).c_str(), 0755);
+
+  ofstream fs(_fname);
+  if (!fs)
+    return false;
+
+  fs << "# RAxML-NG calibration data, can be safely deleted" << endl;
+  fs << setprecision(6);
+  for (const auto& v: _values)
+    fs << v.first << " " << v.second << endl;
+
+  _modified = !fs.good();
+
+  return fs.good();
+}
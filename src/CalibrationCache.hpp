@@ -0,0 +1,37 @@
+#ifndef RAXML_CALIBRATIONCACHE_HPP_
+#define RAXML_CALIBRATIONCACHE_HPP_
+
+#include <string>
+#include <map>
+
+/*
+ * Machine-specific calibration values (kernel timings, barrier latencies etc.), stored as
+ * "key value" lines in a per-host file such that later runs on the same machine can skip
+ * the calibration step.
+ */
+class CalibrationCache
+{
+public:
+  /* default location: $HOME/.raxml-ng/calibration.<hostname> */
+  CalibrationCache();
+  CalibrationCache(const std::string& fname);
+
+  const std::string& fname() const { return _fname; }
+  bool modified() const { return _modified; }
+
+  bool has(const std::string& key) const { return _values.count(key) > 0; }
+  double get(const std::string& key, double default_value = 0.) const;
+  void set(const std::string& key, double value);
+
+  bool load();
+  bool save();
+
+  static std::string default_fname();
+
+private:
+  std::string _fname;
+  std::map<std::string, double> _values;
+  bool _modified;
+};
+
+#endif /* RAXML_CALIBRATIONCACHE_HPP_ */
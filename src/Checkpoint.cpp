@@ -1,4 +1,5 @@
 #include <stdio.h>
+#include <numeric>
 
 #include "Checkpoint.hpp"
 #include "io/binary_io.hpp"
@@ -58,10 +59,45 @@ void CheckpointManager::remove_backup() const
     std::remove(backup_fname().c_str());
 }
 
+void CheckpointManager::init_groups(size_t num_groups)
+{
+  _group_checkp.clear();
+
+  if (num_groups < 2)
+    return;
+
+  for (size_t i = 0; i < num_groups; ++i)
+  {
+    Checkpoint ckp;
+    ckp.models = _checkp.models;
+    ckp.tree = _checkp.tree;
+    _group_checkp.emplace_back(move(ckp));
+  }
+
+  /* NB: an interrupted search will be restarted from scratch, since we don't know which
+   * worker it belongs to */
+  _checkp.search_state = SearchState();
+}
+
+Checkpoint& CheckpointManager::group_checkp()
+{
+  return _group_checkp.empty() ? _checkp : _group_checkp.at(ParallelContext::group_id());
+}
+
+void CheckpointManager::merge_group_checkp(const Checkpoint& ckp)
+{
+  /* NB: must be called from within critical section */
+  if (&ckp != &_checkp)
+  {
+    _checkp.tree = ckp.tree;
+    _checkp.models = ckp.models;
+  }
+}
+
 SearchState& CheckpointManager::search_state()
 {
   if (_active)
-    return _checkp.search_state;
+    return group_checkp().search_state;
   else
   {
     _empty_search_state = SearchState();
@@ -73,30 +109,90 @@ void CheckpointManager::reset_search_state()
 {
   ParallelContext::thread_barrier();
 
-  if (ParallelContext::master_thread())
-    _checkp.search_state = SearchState();
+  if (ParallelContext::group_master_thread())
+    group_checkp().search_state = SearchState();
 
   ParallelContext::thread_barrier();
 };
 
 void CheckpointManager::save_ml_tree()
 {
-  if (ParallelContext::master_thread())
+  if (ParallelContext::group_master_thread())
+    save_ml_tree(group_checkp());
+}
+
+void CheckpointManager::save_ml_tree(const Checkpoint& ckp)
+{
+  ParallelContext::UniqueLock lock;
+  merge_group_checkp(ckp);
+  _checkp.ml_trees.push_back(ckp.loglh(), ckp.tree);
+  if (_active && !_defer_write)
+    write();
+}
+
+void CheckpointManager::save_culled_trees(size_t count)
+{
+  ParallelContext::UniqueLock lock;
+  _checkp.culled_trees += count;
+  if (_active && !_defer_write)
+    write();
+}
+
+void CheckpointManager::save_bs_tree(size_t bs_num)
+{
+  if (ParallelContext::group_master_thread())
   {
-    _checkp.save_ml_tree();
+    if (ParallelContext::mpi_job_queue() && !ParallelContext::master_rank())
+    {
+      const auto& ckp = group_checkp();
+      auto send_cb = [&ckp, bs_num](void * buf, int buf_size) -> int
+        {
+          BinaryStream bs((char*) buf, buf_size);
+          bs << bs_num << ckp.loglh() << ckp.tree.topology();
+          return (int) bs.pos();
+        };
+
+      ParallelContext::mpi_send_master(send_cb);
+      return;
+    }
+
+    ParallelContext::UniqueLock lock;
+    const auto& ckp = group_checkp();
+    merge_group_checkp(ckp);
+    _checkp.bs_trees.push_back(ckp.loglh(), ckp.tree);
+    _checkp.bs_nums.push_back(bs_num);
     if (_active)
       write();
   }
 }
 
-void CheckpointManager::save_bs_tree()
+size_t CheckpointManager::collect_bs_trees(bool wait)
 {
-  if (ParallelContext::master_thread())
+  auto recv_cb = [this](void * buf, int buf_size, size_t rank)
+    {
+      BinaryStream bs((char*) buf, buf_size);
+      const auto bs_num = bs.get<size_t>();
+      const auto loglh = bs.get<double>();
+
+      ParallelContext::UniqueLock lock;
+      _checkp.bs_trees.push_back(loglh, bs.get<TreeTopology>());
+      _checkp.bs_nums.push_back(bs_num);
+
+      LOG_WORKER_TS(LogLevel::info) << "Bootstrap tree #" << bs_num << ", logLikelihood: " <<
+          FMT_LH(loglh) << " (rank #" << rank << ")" << endl;
+    };
+
+  size_t count = 0;
+  while (ParallelContext::mpi_recv_worker(recv_cb, wait && count == 0))
+    ++count;
+
+  if (count > 0 && _active)
   {
-    _checkp.save_bs_tree();
-    if (_active)
-      write();
+    ParallelContext::UniqueLock lock;
+    write();
   }
+
+  return count;
 }
 
 void CheckpointManager::update_and_write(const TreeInfo& treeinfo)
@@ -104,33 +200,49 @@ void CheckpointManager::update_and_write(const TreeInfo& treeinfo)
   if (!_active)
     return;
 
-  if (ParallelContext::master_thread())
-    _updated_models.clear();
+  auto& ckp = group_checkp();
+
+  /* dirty flags are only needed to collect models from other ranks (NB: no worker groups with
+   * MPI, so the flags are never written by multiple groups concurrently) */
+  const bool track_models = ParallelContext::group_ranks() > 1;
+
+  if (track_models && ParallelContext::master_thread())
+    _model_dirty.assign(ckp.models.size(), 0);
 
   ParallelContext::barrier();
 
+  /* NB: models map is filled in advance and every partition has exactly one master thread,
+   * so all threads can update their entries concurrently without locking */
   for (auto p: treeinfo.parts_master())
   {
-    /* we will modify a global map -> define critical section */
-    ParallelContext::UniqueLock lock;
-
-    assign(_checkp.models.at(p), treeinfo, p);
+    assign(ckp.models.at(p), treeinfo, p);
 
-    /* remember which models were updated but this rank ->
+    /* remember which models were updated by this rank ->
      * will be used later to collect them at the master */
-    _updated_models.insert(p);
+    if (track_models)
+      _model_dirty[p] = 1;
   }
 
   ParallelContext::barrier();
 
-  if (ParallelContext::num_ranks() > 1)
+  if (ParallelContext::group_ranks() > 1)
     gather_model_params();
 
-  if (ParallelContext::master())
+  /* NB: in MPI job queue mode, every rank keeps track of its own tree */
+  if (ParallelContext::group_master() ||
+      (ParallelContext::mpi_job_queue() && ParallelContext::group_master_thread()))
   {
-    assign_tree(_checkp, treeinfo);
-    write();
+    assign_tree(ckp, treeinfo);
+
+    /* with multiple worker groups or MPI job queue, checkpoint file is only updated once
+     * a search is finished */
+    if (_group_checkp.empty() && !ParallelContext::mpi_job_queue() && !_defer_write)
+      write();
   }
+
+  /* rank 0 picks up the results of other ranks every now and then */
+  if (ParallelContext::mpi_job_queue() && ParallelContext::group_master())
+    collect_bs_trees(false);
 }
 
 void CheckpointManager::gather_model_params()
@@ -139,10 +251,11 @@ void CheckpointManager::gather_model_params()
   auto worker_cb = [this](void * buf, size_t buf_size) -> int
       {
         BinaryStream bs((char*) buf, buf_size);
-        bs << _updated_models.size();
-        for (auto p: _updated_models)
+        bs << (size_t) count(_model_dirty.cbegin(), _model_dirty.cend(), 1);
+        for (size_t p = 0; p < _model_dirty.size(); ++p)
         {
-          bs << p << _checkp.models.at(p);
+          if (_model_dirty[p])
+            bs << p << _checkp.models.at(p);
         }
         return (int) bs.pos();
       };
@@ -184,6 +297,10 @@ BasicBinaryStream& operator<<(BasicBinaryStream& stream, const Checkpoint& ckp)
 
   stream << ckp.bs_trees;
 
+  stream << ckp.bs_nums;
+
+  stream << ckp.culled_trees;
+
   return stream;
 }
 
@@ -219,6 +336,23 @@ BasicBinaryStream& operator>>(BasicBinaryStream& stream, Checkpoint& ckp)
 
   stream >> ckp.bs_trees;
 
+  /* NB: older versions only inferred bootstrap trees in order */
+  if (ckp.version >= 2)
+    stream >> ckp.bs_nums;
+  else
+  {
+    ckp.bs_nums.resize(ckp.bs_trees.size());
+    iota(ckp.bs_nums.begin(), ckp.bs_nums.end(), 1);
+  }
+
+  if (ckp.version >= 3)
+    stream >> ckp.culled_trees;
+  else
+    ckp.culled_trees = 0;
+
+  /* older checkpoints have been converted, and will be written in the current format */
+  ckp.version = CKP_VERSION;
+
   return stream;
 }
 
@@ -5,7 +5,7 @@
 #include "TreeInfo.hpp"
 #include "io/binary_io.hpp"
 
-constexpr int CKP_VERSION = 1;
+constexpr int CKP_VERSION = 3;
 constexpr int CKP_MIN_SUPPORTED_VERSION = 1;
 
 enum class CheckpointStep
@@ -36,7 +36,8 @@ struct SearchState
 
 struct Checkpoint
 {
-  Checkpoint() : version(CKP_VERSION), elapsed_seconds(0.), search_state(), tree(), models() {}
+  Checkpoint() : version(CKP_VERSION), elapsed_seconds(0.), search_state(), tree(), models(),
+    culled_trees(0) {}
 
   Checkpoint(const Checkpoint& other) = delete;
   Checkpoint& operator=(const Checkpoint& other) = delete;
@@ -54,21 +55,35 @@ struct Checkpoint
 
   TreeCollection ml_trees;
   TreeCollection bs_trees;
+  std::vector<size_t> bs_nums;    /* replicate number of every tree in bs_trees */
+  size_t culled_trees;            /* racing: starting trees culled after FAST SPRs */
 
   double loglh() const { return search_state.loglh; }
 
   void save_ml_tree() { ml_trees.push_back(loglh(), tree); }
-  void save_bs_tree() { bs_trees.push_back(loglh(), tree); }
+  void save_bs_tree(size_t bs_num)
+  {
+    bs_trees.push_back(loglh(), tree);
+    bs_nums.push_back(bs_num);
+  }
 };
 
 class CheckpointManager
 {
 public:
-  CheckpointManager(const std::string& ckp_fname) : _active(true), _ckp_fname(ckp_fname) {}
+  CheckpointManager(const std::string& ckp_fname) : _active(true), _defer_write(false),
+    _ckp_fname(ckp_fname) {}
 
   const Checkpoint& checkpoint() { return _checkp; }
   void checkpoint(Checkpoint&& ckp) { _checkp = std::move(ckp); }
 
+  /* checkpoint of the calling worker group (same as checkpoint() with a single group) */
+  const Checkpoint& group_checkpoint() { return group_checkp(); }
+
+  /* create a private checkpoint for every worker group; results will be merged into the
+   * global checkpoint when a tree search is finished */
+  void init_groups(size_t num_groups);
+
   //TODO: this is not very elegant, but should do the job for now
   SearchState& search_state();
   void reset_search_state();
@@ -76,10 +91,24 @@ public:
   void enable() { _active = true; }
   void disable() { _active = false; }
 
+  /* keep updating the checkpoint in memory, but do not write it to disk until
+   * deferring is switched off again (e.g. intermediate search states while racing) */
+  void defer_write(bool defer) { _defer_write = defer; }
+
   void update_and_write(const TreeInfo& treeinfo);
 
   void save_ml_tree();
-  void save_bs_tree();
+  void save_ml_tree(const Checkpoint& ckp);
+
+  /* racing: culled starting trees are not saved, only counted */
+  void save_culled_trees(size_t count);
+
+  /* NB: in MPI job queue mode, worker ranks send the tree to rank 0 instead */
+  void save_bs_tree(size_t bs_num);
+
+  /* MPI job queue: add bootstrap trees finished by other ranks to the checkpoint (rank 0 only).
+   * If wait is set, block until at least one tree was received. Returns the number of trees */
+  size_t collect_bs_trees(bool wait);
 
   bool read() { return read(_ckp_fname); }
   bool read(const std::string& ckp_fname);
@@ -92,12 +121,16 @@ public:
 
 private:
   bool _active;
+  bool _defer_write;
   std::string _ckp_fname;
   Checkpoint _checkp;
-  IDSet _updated_models;
+  std::vector<Checkpoint> _group_checkp;
+  std::vector<char> _model_dirty;     /* per-partition flags: model updated by this rank */
   SearchState _empty_search_state;
 
   void gather_model_params();
+  Checkpoint& group_checkp();
+  void merge_group_checkp(const Checkpoint& ckp);
   std::string backup_fname() const { return _ckp_fname + ".bk"; }
 };
 
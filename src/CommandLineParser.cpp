@@ -43,6 +43,23 @@ static struct option long_options[] =
   {"all",                no_argument,       0, 0 },  /*  25 */
   {"bs-trees",           required_argument, 0, 0 },  /*  26 */
   {"redo",               no_argument,       0, 0 },  /*  27 */
+  {"barrier",            required_argument, 0, 0 },  /*  28 */
+  {"bench",              required_argument, 0, 0 },  /*  29 */
+  {"workers",            required_argument, 0, 0 },  /*  30 */
+  {"pin",                required_argument, 0, 0 },  /*  31 */
+  {"mpi-threads",        required_argument, 0, 0 },  /*  32 */
+  {"bs-queue",           required_argument, 0, 0 },  /*  33 */
+  {"clv-tasks",          required_argument, 0, 0 },  /*  34 */
+  {"rebalance",          required_argument, 0, 0 },  /*  35 */
+  {"load-balancer",      required_argument, 0, 0 },  /*  36 */
+  {"balance-only",       no_argument,       0, 0 },  /*  37 */
+  {"ranks",              required_argument, 0, 0 },  /*  38 */
+  {"spr-mode",           required_argument, 0, 0 },  /*  39 */
+  {"race",               required_argument, 0, 0 },  /*  40 */
+  {"race-keep",          required_argument, 0, 0 },  /*  41 */
+  {"spr-converge",       required_argument, 0, 0 },  /*  42 */
+  {"spr-memo",           required_argument, 0, 0 },  /*  43 */
+  {"adaptive-modopt",    required_argument, 0, 0 },  /*  44 */
 
   { 0, 0, 0, 0 }
 };
@@ -89,6 +106,15 @@ void CommandLineParser::parse_options(int argc, char** argv, Options &opts)
   opts.spr_radius = -1;
   opts.spr_cutoff = 1.0;
 
+  /* SPR phases end on logLH improvement only */
+  opts.spr_converge = 0;
+
+  /* evaluate all prune nodes in every SPR round */
+  opts.spr_memo = false;
+
+  /* re-optimize all model parameters in every pass */
+  opts.adaptive_modopt = false;
+
   /* default: scaled branch lengths */
   opts.brlen_linkage = PLLMOD_TREE_BRLEN_LINKED;
 
@@ -109,7 +135,40 @@ void CommandLineParser::parse_options(int argc, char** argv, Options &opts)
 
   opts.redo_mode = false;
 
+  /* spin for a while, then block: don't burn cores on oversubscribed nodes */
+  opts.barrier_mode = BarrierMode::adaptive;
+
+  opts.benchmark = BenchmarkType::none;
+
+  /* by default, all threads work on the same tree */
+  opts.num_workers = 1;
+
+  opts.pin_mode = PinMode::none;
+
+  /* only thread 0 talks to MPI */
+  opts.mpi_thread_multiple = false;
+
+  /* by default, all MPI ranks work on the same bootstrap replicate */
+  opts.mpi_bs_queue = false;
+
+  /* data decomposition only */
+  opts.clv_task_threads = 1;
+
+  /* NB: no runtime load balancing by default, since measured thread times would make the data
+   * distribution (and thus the order of floating-point summation) non-reproducible */
+  opts.rebalance_threshold = 0.;
+
+  opts.load_balancer = LoadBalancerType::kassian;
+
+  /* site-parallel SPR rounds, unless there are too few patterns per thread */
+  opts.spr_mode = SprMode::automatic;
+
+  /* finish all starting trees */
+  opts.race_lh_diff = 0.;
+  opts.race_keep = 1;
+
   bool log_level_set = false;
+  bool num_ranks_set = false;
 
   int option_index = 0;
   int c;
@@ -360,6 +419,140 @@ void CommandLineParser::parse_options(int argc, char** argv, Options &opts)
       case 27:
         opts.redo_mode = true;
         break;
+      case 28: /* thread barrier implementation */
+        if (strcasecmp(optarg, "spin") == 0)
+          opts.barrier_mode = BarrierMode::spin;
+        else if (strcasecmp(optarg, "adaptive") == 0)
+          opts.barrier_mode = BarrierMode::adaptive;
+        else if (strcasecmp(optarg, "block") == 0)
+          opts.barrier_mode = BarrierMode::block;
+        else
+          throw InvalidOptionValueException("Unknown thread barrier mode: " + string(optarg));
+        break;
+      case 29: /* micro-benchmarks */
+        if (strcasecmp(optarg, "barrier") == 0)
+          opts.benchmark = BenchmarkType::barrier;
+        else if (strcasecmp(optarg, "reduce") == 0)
+          opts.benchmark = BenchmarkType::reduce;
+        else
+          throw InvalidOptionValueException("Unknown benchmark: " + string(optarg));
+        opts.command = Command::benchmark;
+        num_commands++;
+        break;
+      case 30: /* number of worker groups (parallel tree searches) */
+        if (strcasecmp(optarg, "auto") == 0)
+          opts.num_workers = 0;
+        else if (sscanf(optarg, "%u", &opts.num_workers) != 1 || opts.num_workers == 0)
+        {
+          throw InvalidOptionValueException("Invalid number of workers: " + string(optarg) +
+                                            ", please provide a positive integer number!");
+        }
+        break;
+      case 31: /* thread pinning */
+        if (strcasecmp(optarg, "none") == 0 || strcasecmp(optarg, "off") == 0)
+          opts.pin_mode = PinMode::none;
+        else if (strcasecmp(optarg, "compact") == 0)
+          opts.pin_mode = PinMode::compact;
+        else if (strcasecmp(optarg, "scatter") == 0)
+          opts.pin_mode = PinMode::scatter;
+        else if (strcasecmp(optarg, "numa") == 0)
+          opts.pin_mode = PinMode::numa;
+        else
+          throw InvalidOptionValueException("Unknown thread pinning mode: " + string(optarg));
+        break;
+      case 32: /* MPI threading mode */
+        if (strcasecmp(optarg, "funneled") == 0)
+          opts.mpi_thread_multiple = false;
+        else if (strcasecmp(optarg, "multiple") == 0)
+          opts.mpi_thread_multiple = true;
+        else
+          throw InvalidOptionValueException("Unknown MPI threading mode: " + string(optarg));
+        break;
+      case 33: /* MPI: dynamic distribution of bootstrap replicates */
+        opts.mpi_bs_queue = !optarg || (strcasecmp(optarg, "off") != 0);
+        break;
+      case 34: /* task-parallel CLV updates */
+        if (sscanf(optarg, "%u", &opts.clv_task_threads) != 1 || opts.clv_task_threads == 0)
+        {
+          throw InvalidOptionValueException("Invalid number of CLV task threads: " +
+                                            string(optarg) + ", please provide a positive integer number!");
+        }
+        break;
+      case 35: /* runtime load balancing */
+        if (strcasecmp(optarg, "off") == 0)
+          opts.rebalance_threshold = 0.;
+        else if (sscanf(optarg, "%lf", &opts.rebalance_threshold) != 1 ||
+                 opts.rebalance_threshold < 1.)
+        {
+          throw InvalidOptionValueException("Invalid load imbalance threshold: " + string(optarg) +
+                                            ", please provide a real number >= 1.0!");
+        }
+        break;
+      case 36: /* load balancing strategy */
+        if (strcasecmp(optarg, "kassian") == 0)
+          opts.load_balancer = LoadBalancerType::kassian;
+        else if (strcasecmp(optarg, "simple") == 0)
+          opts.load_balancer = LoadBalancerType::simple;
+        else if (strcasecmp(optarg, "makespan") == 0)
+          opts.load_balancer = LoadBalancerType::makespan;
+        else
+          throw InvalidOptionValueException("Unknown load balancer: " + string(optarg));
+        break;
+      case 37:
+        opts.command = Command::balance;
+        num_commands++;
+        break;
+      case 38: /* number of MPI ranks to plan the data distribution for */
+        if (sscanf(optarg, "%u", &opts.num_ranks) != 1 || opts.num_ranks == 0)
+        {
+          throw InvalidOptionValueException("Invalid number of ranks: " + string(optarg) +
+                                            ", please provide a positive integer number!");
+        }
+        num_ranks_set = true;
+        break;
+      case 39: /* parallelization of SPR rounds */
+        if (strcasecmp(optarg, "auto") == 0)
+          opts.spr_mode = SprMode::automatic;
+        else if (strcasecmp(optarg, "sites") == 0)
+          opts.spr_mode = SprMode::sites;
+        else if (strcasecmp(optarg, "candidates") == 0)
+          opts.spr_mode = SprMode::candidates;
+        else
+          throw InvalidOptionValueException("Unknown SPR mode: " + string(optarg));
+        break;
+      case 40: /* racing multi-start search */
+        if (strcasecmp(optarg, "off") == 0)
+          opts.race_lh_diff = 0.;
+        else if (strcasecmp(optarg, "auto") == 0)
+          opts.race_lh_diff = -1.;
+        else if (sscanf(optarg, "%lf", &opts.race_lh_diff) != 1 || opts.race_lh_diff <= 0.)
+        {
+          throw InvalidOptionValueException("Invalid racing logLH difference: " + string(optarg) +
+                                            ", please provide a positive real number!");
+        }
+        break;
+      case 41: /* racing: minimum number of starting trees to finish */
+        if (sscanf(optarg, "%u", &opts.race_keep) != 1 || opts.race_keep == 0)
+        {
+          throw InvalidOptionValueException("Invalid number of starting trees to keep: " +
+                                            string(optarg) + ", please provide a positive integer number!");
+        }
+        break;
+      case 42: /* topology convergence: number of SPR rounds without topology change */
+        if (strcasecmp(optarg, "off") == 0)
+          opts.spr_converge = 0;
+        else if (sscanf(optarg, "%u", &opts.spr_converge) != 1 || opts.spr_converge == 0)
+        {
+          throw InvalidOptionValueException("Invalid number of SPR rounds: " + string(optarg) +
+                                            ", please provide a positive integer number!");
+        }
+        break;
+      case 43: /* SPR memo: skip prune nodes whose neighborhood did not change */
+        opts.spr_memo = !optarg || (strcasecmp(optarg, "off") != 0);
+        break;
+      case 44: /* adaptive model optimization: skip converged parameters */
+        opts.adaptive_modopt = !optarg || (strcasecmp(optarg, "off") != 0);
+        break;
       default:
         throw  OptionException("Internal error in option parsing");
     }
@@ -372,9 +565,14 @@ void CommandLineParser::parse_options(int argc, char** argv, Options &opts)
   if (num_commands > 1)
     throw OptionException("More than one command specified");
 
+  /* actual number of ranks is determined by MPI */
+  if (num_ranks_set && opts.command != Command::balance)
+    throw OptionException("--ranks can only be used with --balance-only");
+
   /* check for mandatory options for each command */
   if (opts.command == Command::evaluate || opts.command == Command::search ||
-      opts.command == Command::bootstrap || opts.command == Command::all)
+      opts.command == Command::bootstrap || opts.command == Command::all ||
+      opts.command == Command::balance)
   {
     if (opts.msa_file.empty())
       throw OptionException("You must specify a multiple alignment file with --msa switch");
@@ -401,6 +599,39 @@ void CommandLineParser::parse_options(int argc, char** argv, Options &opts)
       opts.num_searches = 1;
   }
 
+  if (opts.num_workers > 1)
+  {
+    if (opts.num_ranks > 1)
+      throw OptionException("Parallel tree searches (--workers) are not supported with MPI yet");
+
+    if (opts.num_workers > opts.num_threads || opts.num_threads % opts.num_workers != 0)
+    {
+      throw OptionException("Number of threads (" + to_string(opts.num_threads) +
+                            ") must be a multiple of the number of workers (" +
+                            to_string(opts.num_workers) + ")");
+    }
+  }
+
+  if (opts.clv_task_threads > 1)
+  {
+    const unsigned int group_threads = opts.num_threads / max(opts.num_workers, 1u);
+    if (group_threads % opts.clv_task_threads != 0)
+    {
+      throw OptionException("Number of threads per worker (" + to_string(group_threads) +
+                            ") must be a multiple of the number of CLV task threads (" +
+                            to_string(opts.clv_task_threads) + ")");
+    }
+  }
+
+  if (opts.spr_mode == SprMode::candidates)
+  {
+    if (opts.clv_task_threads > 1)
+      throw OptionException("--spr-mode candidates can not be combined with --clv-tasks");
+
+    if (opts.brlen_linkage == PLLMOD_TREE_BRLEN_UNLINKED)
+      throw OptionException("--spr-mode candidates is not supported with unlinked branch lengths");
+  }
+
   /* set default log output level  */
   if (!log_level_set)
   {
@@ -424,6 +655,8 @@ void CommandLineParser::print_help()
             "  --search                                   ML tree search.\n"
             "  --bootstrap                                bootstrapping.\n"
             "  --all                                      All-in-one (ML search + bootstrapping).\n"
+            "  --bench        barrier | reduce            run parallelization micro-benchmark.\n"
+            "  --balance-only                             print data distribution for up to --threads x --ranks processors and exit.\n"
             "\n"
             "Input and output options:\n"
             "  --tree         FILE | rand{N} | pars{N}    starting tree: rand(om), pars(imony) or user-specified (newick file)\n"
@@ -442,18 +675,34 @@ void CommandLineParser::print_help()
             "  --threads      VALUE                       number of parallel threads to use (default: 2).\n"
             "  --simd         none | sse3 | avx | avx2    vector instruction set to use (default: auto-detect).\n"
             "  --rate-scalers on | off                    use individual CLV scalers for each rate category (default: OFF).\n"
+            "  --barrier      spin | adaptive | block     thread synchronization: busy-wait, spin-then-sleep or sleep (default: adaptive).\n"
+            "  --workers      VALUE | auto                number of tree searches/bootstraps to run in parallel (default: 1).\n"
+            "  --pin          none | compact | scatter | numa  pin threads to cores (default: none).\n"
+            "  --mpi-threads  funneled | multiple         hybrid MPI+threads: only thread 0 or all threads call MPI (default: funneled).\n"
+            "  --bs-queue     on | off                    MPI: every rank infers whole bootstrap trees, replicates are handed out on demand (default: OFF).\n"
+            "  --clv-tasks    VALUE                       threads sharing one data slice and updating CLVs of independent subtrees concurrently,\n"
+            "                                             only used with few patterns per thread (default: 1).\n"
+            "  --rebalance    VALUE | off                 re-distribute data between threads if max/avg thread time exceeds VALUE, e.g. 1.1 (default: OFF).\n"
+            "  --load-balancer kassian | simple | makespan  distribution of partitions among threads (default: kassian).\n"
+            "  --spr-mode     sites | candidates | auto   threads split alignment sites or SPR candidates of a round (default: auto).\n"
+            "  --ranks        VALUE                       number of MPI ranks to plan for (--balance-only, default: 1).\n"
             "\n"
             "Model options:\n"
             "  --model        <name>+G[n]+<Freqs> | FILE  model specification OR partition file (default: GTR+G4)\n"
             "  --brlen        linked | scaled | unlinked  branch length linkage between partitions (default: scaled)\n"
             "  --opt-model    on | off                    ML optimization of all model parameters (default: ON)\n"
             "  --opt-branches on | off                    ML optimization of all branch lengths (default: ON)\n"
+            "  --adaptive-modopt on | off                 skip converged model parameters in repeated optimization passes (default: OFF)\n"
             "  --prob-msa     on | off                    use probabilistic alignment (works with CATG and VCF)\n"
             "  --lh-epsilon   VALUE                       log-likelihood epsilon for optimization/tree search (default: 0.1)\n"
             "\n"
             "Topology search options:\n"
             "  --spr-radius   VALUE                       SPR re-insertion radius for fast iterations (default: AUTO)\n"
             "  --spr-cutoff   VALUE | off                 Relative LH cutoff for descending into subtrees (default: 1.0)\n"
+            "  --spr-converge VALUE | off                 end a FAST/SLOW SPR phase once the topology is unchanged for VALUE rounds (default: OFF)\n"
+            "  --spr-memo     on | off                    skip subtrees without improving moves until their neighborhood changes (default: OFF)\n"
+            "  --race         VALUE | auto | off          drop starting trees more than VALUE logLH units behind the best after FAST SPRs (default: OFF)\n"
+            "  --race-keep    VALUE                       minimum number of starting trees to finish when racing (default: 1)\n"
             "\n"
             "Bootstrapping options:\n"
             "  --bs-trees     VALUE                       Number of bootstraps replicates (default: 100)\n";
@@ -2,6 +2,9 @@
 #include <stack>
 #include <algorithm>
 #include <stdexcept>
+#include <limits>
+#include <cmath>
+#include <unordered_map>
 
 #include "LoadBalancer.hpp"
 
@@ -18,9 +21,42 @@ LoadBalancer::~LoadBalancer ()
   // TODO Auto-generated destructor stub
 }
 
+unique_ptr<LoadBalancer> LoadBalancer::create(LoadBalancerType type)
+{
+  switch (type)
+  {
+    case LoadBalancerType::simple:
+      return unique_ptr<LoadBalancer>(new SimpleLoadBalancer());
+    case LoadBalancerType::kassian:
+      return unique_ptr<LoadBalancer>(new KassianLoadBalancer());
+    case LoadBalancerType::makespan:
+      return unique_ptr<LoadBalancer>(new MakespanLoadBalancer());
+    default:
+      throw runtime_error("Unknown load balancer type");
+  }
+}
+
+std::string load_balancer_name(LoadBalancerType type)
+{
+  switch (type)
+  {
+    case LoadBalancerType::simple:
+      return "simple";
+    case LoadBalancerType::kassian:
+      return "kassian";
+    case LoadBalancerType::makespan:
+      return "makespan";
+    default:
+      return "UNKNOWN";
+  }
+}
+
 PartitionAssignmentList LoadBalancer::get_all_assignments(const PartitionAssignment& part_sizes,
                                                           size_t num_procs)
 {
+  if (!_capacities.empty() && _capacities.size() != num_procs)
+    throw runtime_error("Number of thread capacities doesn't match the number of threads");
+
   if (num_procs == 1)
     return PartitionAssignmentList(1, part_sizes);
   else
@@ -32,6 +68,8 @@ PartitionAssignment LoadBalancer::get_proc_assignments(const PartitionAssignment
 {
   if (proc_id >= num_procs)
     throw std::out_of_range("Process ID out of range");
+  if (!_capacities.empty() && _capacities.size() != num_procs)
+    throw runtime_error("Number of thread capacities doesn't match the number of threads");
 
   if (num_procs == 1)
     return part_sizes;
@@ -44,6 +82,35 @@ PartitionAssignmentList SimpleLoadBalancer::compute_assignments(const PartitionA
 {
   PartitionAssignmentList part_assign(num_procs);
 
+  if (!_capacities.empty())
+  {
+    /* every partition is split proportionally to the thread capacities */
+    double total_capacity = 0.;
+    for (auto c: _capacities)
+      total_capacity += c;
+
+    for (auto const& full_range: part_sizes)
+    {
+      const size_t total_sites = full_range.length;
+      double cum_capacity = 0.;
+      size_t start = 0;
+      for (size_t proc_id = 0; proc_id < num_procs; ++proc_id)
+      {
+        cum_capacity += _capacities[proc_id];
+        const size_t end = (proc_id == num_procs-1) ? total_sites :
+            min(total_sites, (size_t) (total_sites * cum_capacity / total_capacity));
+        if (end > start)
+        {
+          part_assign[proc_id].assign_sites(full_range.part_id, full_range.start + start,
+                                            end - start, full_range.site_cost);
+          start = end;
+        }
+      }
+    }
+
+    return part_assign;
+  }
+
   size_t proc_id = 0;
   for (auto& proc_assign: part_assign)
   {
@@ -54,7 +121,7 @@ PartitionAssignmentList SimpleLoadBalancer::compute_assignments(const PartitionA
       auto part_id = full_range.part_id;
       auto start = full_range.start + proc_id * proc_sites;
       auto length = (proc_id == num_procs-1) ? total_sites - start : proc_sites;
-      proc_assign.assign_sites(part_id, start, length);
+      proc_assign.assign_sites(part_id, start, length, full_range.site_cost);
     }
     ++proc_id;
   }
@@ -64,108 +131,197 @@ PartitionAssignmentList SimpleLoadBalancer::compute_assignments(const PartitionA
   return part_assign;
 }
 
+/* Kassian works with integer weights: convert per-site costs into integer units, such that
+ * the cheapest site type is worth a small number of units (1 if all costs are equal) */
+static vector<size_t> site_cost_units(const PartitionAssignment& part_sizes)
+{
+  const size_t resolution = 16;
+
+  double min_cost = numeric_limits<double>::max();
+  for (auto const& range: part_sizes)
+    min_cost = min(min_cost, range.site_cost);
+
+  vector<size_t> units;
+  size_t units_gcd = 0;
+  for (auto const& range: part_sizes)
+  {
+    const size_t u = max<size_t>(1, llround(range.site_cost / min_cost * resolution));
+    units.push_back(u);
+
+    size_t a = units_gcd, b = u;
+    while (b)
+    {
+      const size_t t = a % b;
+      a = b;
+      b = t;
+    }
+    units_gcd = a;
+  }
+
+  for (auto& u: units)
+    u /= units_gcd;
+
+  return units;
+}
+
 PartitionAssignmentList KassianLoadBalancer::compute_assignments(const PartitionAssignment& part_sizes,
                                                                  size_t num_procs)
 {
   PartitionAssignmentList bins(num_procs);
 
-  // Sort the partitions by size in ascending order
-  vector<const PartitionRange*> sorted_partitions;
-  for (auto const& range: part_sizes)
-    sorted_partitions.push_back(&range);
+  /* partition weight = sites x cost units per site */
+  struct WeightedRange
+  {
+    const PartitionRange * range;
+    size_t site_units;
+    size_t weight;
+  };
+
+  const auto units = site_cost_units(part_sizes);
+
+  // Sort the partitions by weight in ascending order
+  vector<WeightedRange> sorted_partitions;
+  for (size_t i = 0; i < part_sizes.num_parts(); ++i)
+  {
+    const PartitionRange& range = part_sizes[i];
+    sorted_partitions.push_back({&range, units[i], range.length * units[i]});
+  }
   sort(sorted_partitions.begin(), sorted_partitions.end(),
-       [](const PartitionRange *r1, const PartitionRange *r2) { return (r1->length < r2->length);} );
+       [](const WeightedRange& r1, const WeightedRange& r2) { return (r1.weight < r2.weight);} );
 
-  // Compute the maximum number of sites per Bin
-  size_t total_sites = 0;
-  for (auto const& range: part_sizes)
+  // Compute the maximum weight per Bin
+  size_t total_weight = 0;
+  for (auto const& part: sorted_partitions)
+  {
+    total_weight += part.weight;
+  }
+
+  /* weight of each bin, in cost units (bins[i].weight() is the number of sites) */
+  vector<size_t> bin_weight(num_procs, 0);
+
+  /* assign the part of the partition which corresponds to the weight range
+   * [offset, offset+amount): site boundaries are rounded down, so that consecutive
+   * chunks cover the partition without gaps or overlaps */
+  auto assign_chunk = [&bins, &bin_weight](size_t bin, const WeightedRange& part,
+                                          size_t offset, size_t amount)
+    {
+      const size_t start = offset / part.site_units;
+      const size_t end = (offset + amount) / part.site_units;
+      if (end > start)
+        bins[bin].assign_sites(part.range->part_id, start, end - start, part.range->site_cost);
+      bin_weight[bin] += amount;
+    };
+
+  /* target weight of each bin: with equal capacities, r bins get one unit less than the others */
+  vector<size_t> max_weight(num_procs);
+  size_t r = 0;
+  if (_capacities.empty())
   {
-    total_sites += range.length;
+    std::fill(max_weight.begin(), max_weight.end(), (total_weight - 1) / bins.size() + 1);
+    r = (max_weight[0] * bins.size()) - total_weight;
+  }
+  else
+  {
+    /* proportional to capacities, rounded such that the targets add up to total_weight */
+    double total_capacity = 0.;
+    for (auto c: _capacities)
+      total_capacity += c;
+
+    double cum_capacity = 0.;
+    size_t cum_weight = 0;
+    for (size_t b = 0; b < num_procs; ++b)
+    {
+      cum_capacity += _capacities[b];
+      const size_t bound = (b == num_procs-1) ? total_weight :
+          min(total_weight, (size_t) (total_weight * cum_capacity / total_capacity));
+      max_weight[b] = bound - min(bound, cum_weight);
+      cum_weight = max(cum_weight, bound);
+    }
   }
+  size_t curr_part = 0; // index in sorted_partitons (AND NOT IN _partitions)
+  size_t full_bins = 0;
+  size_t current_bin = 0;
 
-  unsigned int max_sites = (total_sites - 1) / bins.size() + 1;
-  unsigned int r = (max_sites * bins.size()) - total_sites;
-  unsigned int curr_part = 0; // index in sorted_partitons (AND NOT IN _partitions)
-  unsigned int full_bins = 0;
-  unsigned int current_bin = 0;
+  // border case : once bins.size() - r bins are full, the remaining ones should not
+  // exceed max_weight - 1
+  auto bin_filled = [&full_bins, &max_weight, &bins, r]()
+    {
+      if (++full_bins == (bins.size() - r))
+      {
+        for (auto& w: max_weight)
+          w -= w > 0 ? 1 : 0;
+      }
+    };
 
-//  vector<size_t> weights(num_procs, 0);
   vector<bool> full(num_procs, false);
 
   // Assign partitions in a cyclic manner to bins until one is too big
   for (; curr_part < sorted_partitions.size(); ++curr_part)
   {
-    const PartitionRange *partition = sorted_partitions[curr_part];
+    const WeightedRange& partition = sorted_partitions[curr_part];
     current_bin = curr_part % bins.size();
-    if (partition->length + bins[current_bin].weight() > max_sites)
+    if (partition.weight + bin_weight[current_bin] > max_weight[current_bin])
     {
       // the partition exceeds the current bin's size, go to the next step of the algo
       break;
     }
     // add the partition !
-    bins[current_bin].assign_sites(partition->part_id, 0, partition->length);
-    if (bins[current_bin].weight() == max_sites)
+    assign_chunk(current_bin, partition, 0, partition.weight);
+    if (bin_weight[current_bin] == max_weight[current_bin])
     {
       // one more bin is exactly full
-      if (++full_bins == (bins.size() - r))
-      {
-        // border case : the remaining bins should not exceed max_sites - 1
-        max_sites--;
-      }
-      // flag it as full (its harder to rely on max_sites because its value changes)
+      bin_filled();
+      // flag it as full (its harder to rely on max_weight because its value changes)
       full[current_bin] = true;
     }
   }
 
-  stack<PartitionAssignment *> qlow_;
-  stack<PartitionAssignment *> *qlow = &qlow_; // hack to assign qhigh to qlow when qlow is empty
-  stack<PartitionAssignment *> qhigh;
-  for (unsigned int i = 0; i < current_bin; ++i)
+  stack<size_t> qlow_;
+  stack<size_t> *qlow = &qlow_; // hack to assign qhigh to qlow when qlow is empty
+  stack<size_t> qhigh;
+  for (size_t i = 0; i < current_bin; ++i)
   {
     if (!full[current_bin])
     {
-      qhigh.push(&bins[i]);
+      qhigh.push(i);
     }
   }
-  for (unsigned int i = current_bin; i < bins.size(); ++i)
+  for (size_t i = current_bin; i < bins.size(); ++i)
   {
     if (!full[current_bin])
     {
-      qlow->push(&bins[i]);
+      qlow->push(i);
     }
   }
-  unsigned int remaining = sorted_partitions[curr_part]->length;
+  size_t remaining = curr_part < sorted_partitions.size() ?
+                                        sorted_partitions[curr_part].weight : 0;
   while (curr_part < sorted_partitions.size() && (qlow->size() || qhigh.size()))
   {
-    const PartitionRange *partition = sorted_partitions[curr_part];
+    const WeightedRange& partition = sorted_partitions[curr_part];
     // try to dequeue a process from Qhigh and to fill it
-    if (qhigh.size() && (qhigh.top()->weight() + remaining >= max_sites))
+    if (qhigh.size() && (bin_weight[qhigh.top()] + remaining >= max_weight[qhigh.top()]))
     {
-      PartitionAssignment * bin = qhigh.top();
+      const size_t bin = qhigh.top();
       qhigh.pop();
-      unsigned int toassign = max_sites - bin->weight();
-      bin->assign_sites(partition->part_id, partition->length - remaining, toassign);
+      const size_t toassign = max_weight[bin] - bin_weight[bin];
+      assign_chunk(bin, partition, partition.weight - remaining, toassign);
       remaining -= toassign;
-      if (++full_bins == (bins.size() - r)) {
-        max_sites--;
-      }
+      bin_filled();
     }
-    else if ((qlow->top()->weight() + remaining >= max_sites))
+    else if ((bin_weight[qlow->top()] + remaining >= max_weight[qlow->top()]))
     { // same with qlow
-      PartitionAssignment * bin = qlow->top();
+      const size_t bin = qlow->top();
       qlow->pop();
-      unsigned int toassign = max_sites - bin->weight();
-      bin->assign_sites(partition->part_id, partition->length - remaining, toassign);
+      const size_t toassign = max_weight[bin] - bin_weight[bin];
+      assign_chunk(bin, partition, partition.weight - remaining, toassign);
       remaining -= toassign;
-      if (++full_bins == (bins.size() - r)) {
-        max_sites--;
-      }
+      bin_filled();
     }
     else
     {
-      PartitionAssignment * bin = qlow->top();
+      const size_t bin = qlow->top();
       qlow->pop();
-      bin->assign_sites(partition->part_id, partition->length - remaining, remaining);
+      assign_chunk(bin, partition, partition.weight - remaining, remaining);
       remaining = 0;
       qhigh.push(bin);
     }
@@ -178,10 +334,341 @@ PartitionAssignmentList KassianLoadBalancer::compute_assignments(const Partition
     {
       if (++curr_part < sorted_partitions.size())
       {
-        remaining = sorted_partitions[curr_part]->length;
+        remaining = sorted_partitions[curr_part].weight;
       }
     }
   }
 
   return bins;
 }
+
+namespace
+{
+  struct Chunk
+  {
+    size_t part_id;
+    size_t start;
+    size_t length;
+    double site_cost;
+    double overhead;
+
+    double cost() const { return length * site_cost + overhead; }
+  };
+
+  struct Bin
+  {
+    Bin() : load(0.) {}
+
+    std::vector<Chunk> chunks;
+    double load;
+  };
+
+  /* keeps track of which bins hold a slice of which partition (at most one per bin, since
+   * TreeInfo expects a single contiguous range per partition and thread) */
+  class BinSet
+  {
+  public:
+    BinSet(size_t num_bins) : _bins(num_bins) {}
+
+    size_t size() const { return _bins.size(); }
+    const Bin& operator[](size_t i) const { return _bins[i]; }
+
+    bool has_part(size_t bin, size_t part_id) const
+    {
+      auto it = _part_bins.find(part_id);
+      return it != _part_bins.end() &&
+          find(it->second.cbegin(), it->second.cend(), bin) != it->second.cend();
+    }
+
+    void add(size_t bin, const Chunk& chunk)
+    {
+      _bins[bin].chunks.push_back(chunk);
+      _bins[bin].load += chunk.cost();
+      _part_bins[chunk.part_id].push_back(bin);
+    }
+
+    Chunk remove(size_t bin, size_t idx)
+    {
+      auto& chunks = _bins[bin].chunks;
+      Chunk chunk = chunks[idx];
+      chunks.erase(chunks.begin() + idx);
+      _bins[bin].load -= chunk.cost();
+
+      auto& pb = _part_bins[chunk.part_id];
+      pb.erase(find(pb.begin(), pb.end(), bin));
+
+      return chunk;
+    }
+
+  private:
+    std::vector<Bin> _bins;
+    std::unordered_map<size_t, std::vector<size_t>> _part_bins;
+  };
+
+  /* local search step types */
+  enum class MoveType
+  {
+    none,
+    move,
+    swap,
+    split
+  };
+}
+
+double MakespanLoadBalancer::makespan(const PartitionAssignmentList& part_assign) const
+{
+  double max_load = 0.;
+  for (size_t i = 0; i < part_assign.size(); ++i)
+  {
+    double load = 0.;
+    for (auto const& range: part_assign[i])
+      load += range.cost() + range.site_cost * _slice_overhead;
+    max_load = max(max_load, load / capacity(i));
+  }
+  return max_load;
+}
+
+PartitionAssignmentList MakespanLoadBalancer::compute_assignments(const PartitionAssignment& part_sizes,
+                                                                  size_t num_procs)
+{
+  BinSet bins(num_procs);
+
+  /* average load per bin, assuming every partition is assigned as a whole */
+  double total_cost = 0.;
+  for (auto const& range: part_sizes)
+    total_cost += range.cost() + range.site_cost * _slice_overhead;
+  const double avg_load = total_cost / num_procs;
+
+  /* split partitions which are larger than the average load into equal chunks */
+  vector<Chunk> chunks;
+  for (auto const& range: part_sizes)
+  {
+    if (!range.length)
+      continue;
+
+    const double overhead = range.site_cost * _slice_overhead;
+    size_t num_chunks = avg_load > 0. ? (size_t) ceil(range.cost() / avg_load) : 1;
+    num_chunks = max<size_t>(1, min(num_chunks, min(num_procs, range.length)));
+
+    size_t start = range.start;
+    for (size_t i = 0; i < num_chunks; ++i)
+    {
+      const size_t length = range.length / num_chunks + (i < range.length % num_chunks ? 1 : 0);
+      chunks.push_back({range.part_id, start, length, range.site_cost, overhead});
+      start += length;
+    }
+  }
+
+  /* LPT: largest chunk first, to the bin which would finish it first and doesn't hold this
+   * partition yet */
+  stable_sort(chunks.begin(), chunks.end(),
+              [](const Chunk& c1, const Chunk& c2) { return c1.cost() > c2.cost(); } );
+
+  for (auto const& chunk: chunks)
+  {
+    size_t best_bin = num_procs;
+    double best_time = 0.;
+    for (size_t b = 0; b < num_procs; ++b)
+    {
+      const double time = (bins[b].load + chunk.cost()) / capacity(b);
+      if ((best_bin == num_procs || time < best_time) && !bins.has_part(b, chunk.part_id))
+      {
+        best_bin = b;
+        best_time = time;
+      }
+    }
+    assert(best_bin < num_procs);
+    bins.add(best_bin, chunk);
+  }
+
+  /* local search: improve the pair (most loaded, least loaded bin) until no step helps */
+  const size_t max_iters = 10 * (num_procs + chunks.size());
+  for (size_t iter = 0; iter < max_iters; ++iter)
+  {
+    /* NB: "load" is in cost units, "time" is load / capacity */
+    size_t hi = 0, lo = 0;
+    for (size_t b = 1; b < num_procs; ++b)
+    {
+      if (bins[b].load / capacity(b) > bins[hi].load / capacity(hi))
+        hi = b;
+      if (bins[b].load / capacity(b) < bins[lo].load / capacity(lo))
+        lo = b;
+    }
+
+    const double hi_load = bins[hi].load;
+    const double lo_load = bins[lo].load;
+    const double hi_cap = capacity(hi);
+    const double lo_cap = capacity(lo);
+    const double hi_time = hi_load / hi_cap;
+    if (hi == lo || !(hi_time - lo_load / lo_cap > hi_time * 1e-9))
+      break;
+
+    /* new max. time of the pair after moving cost delta (plus extra overhead) from hi to lo */
+    auto pair_max = [hi_load, lo_load, hi_cap, lo_cap](double delta, double extra) -> double
+      { return max((hi_load - delta) / hi_cap, (lo_load + delta + extra) / lo_cap); };
+
+    MoveType best_type = MoveType::none;
+    double best_max = hi_time * (1. - 1e-9);
+    size_t best_hi_idx = 0, best_lo_idx = 0, best_sites = 0;
+
+    const auto& hi_chunks = bins[hi].chunks;
+    const auto& lo_chunks = bins[lo].chunks;
+
+    for (size_t i = 0; i < hi_chunks.size(); ++i)
+    {
+      const Chunk& c = hi_chunks[i];
+      const bool lo_free = !bins.has_part(lo, c.part_id);
+
+      /* move the whole chunk */
+      if (lo_free && pair_max(c.cost(), 0.) < best_max)
+      {
+        best_type = MoveType::move;
+        best_max = pair_max(c.cost(), 0.);
+        best_hi_idx = i;
+      }
+
+      /* move part of the chunk: creates a new slice in lo, such that both finish together */
+      if (lo_free && c.length > 1)
+      {
+        const double sites = (lo_cap * hi_load - hi_cap * (lo_load + c.overhead)) /
+            ((hi_cap + lo_cap) * c.site_cost);
+        if (sites >= 1.)
+        {
+          const size_t m = min(c.length - 1, (size_t) sites);
+          const double pm = pair_max(m * c.site_cost, c.overhead);
+          if (pm < best_max)
+          {
+            best_type = MoveType::split;
+            best_max = pm;
+            best_hi_idx = i;
+            best_sites = m;
+          }
+        }
+      }
+
+      /* swap with a smaller chunk from lo */
+      for (size_t j = 0; j < lo_chunks.size(); ++j)
+      {
+        const Chunk& x = lo_chunks[j];
+        const double delta = c.cost() - x.cost();
+        if (delta <= 0.)
+          continue;
+
+        const bool allowed = (c.part_id == x.part_id) ||
+            (lo_free && !bins.has_part(hi, x.part_id));
+        if (allowed && pair_max(delta, 0.) < best_max)
+        {
+          best_type = MoveType::swap;
+          best_max = pair_max(delta, 0.);
+          best_hi_idx = i;
+          best_lo_idx = j;
+        }
+      }
+    }
+
+    if (best_type == MoveType::none)
+      break;
+    else if (best_type == MoveType::move)
+      bins.add(lo, bins.remove(hi, best_hi_idx));
+    else if (best_type == MoveType::swap)
+    {
+      Chunk c = bins.remove(hi, best_hi_idx);
+      Chunk x = bins.remove(lo, best_lo_idx);
+      bins.add(lo, c);
+      bins.add(hi, x);
+    }
+    else
+    {
+      /* split off the tail of the chunk */
+      Chunk c = bins.remove(hi, best_hi_idx);
+      Chunk tail = c;
+      c.length -= best_sites;
+      tail.start = c.start + c.length;
+      tail.length = best_sites;
+      bins.add(hi, c);
+      bins.add(lo, tail);
+    }
+  }
+
+  PartitionAssignmentList result(num_procs);
+  for (size_t b = 0; b < num_procs; ++b)
+  {
+    auto bin_chunks = bins[b].chunks;
+    sort(bin_chunks.begin(), bin_chunks.end(),
+         [](const Chunk& c1, const Chunk& c2) { return c1.part_id < c2.part_id; } );
+    for (auto const& c: bin_chunks)
+      result[b].assign_sites(c.part_id, c.start, c.length, c.site_cost);
+  }
+
+  return result;
+}
+
+PartitionAssignment calibrate_site_costs(const PartitionAssignment& part_sizes,
+                                         const PartitionAssignmentList& assignments,
+                                         const std::vector<double>& times,
+                                         const std::vector<double>& capacities)
+{
+  assert(assignments.size() == times.size());
+  assert(capacities.empty() || capacities.size() == times.size());
+
+  /* measured time per estimated cost unit, for every thread (scaled to a thread of
+   * capacity 1.0, i.e. a faster thread needed more time for the same work) */
+  vector<double> time_ratio(assignments.size(), 0.);
+  double total_time = 0., total_cost = 0.;
+  for (size_t i = 0; i < assignments.size(); ++i)
+  {
+    if (assignments[i].cost() > 0.)
+    {
+      const double work_time = capacities.empty() ? times[i] : times[i] * capacities[i];
+      time_ratio[i] = work_time / assignments[i].cost();
+      total_time += work_time;
+      total_cost += assignments[i].cost();
+    }
+  }
+
+  if (!(total_time > 0.))
+    return part_sizes;
+
+  /* new cost of a partition site: average over all threads working on this partition,
+   * normalized such that the total cost remains the same */
+  const double norm = total_cost / total_time;
+  PartitionAssignment result;
+  for (auto const& full_range: part_sizes)
+  {
+    double sum_cost = 0.;
+    size_t sum_sites = 0;
+    for (size_t i = 0; i < assignments.size(); ++i)
+    {
+      for (auto const& range: assignments[i])
+      {
+        if (range.part_id == full_range.part_id && time_ratio[i] > 0.)
+        {
+          sum_cost += range.cost() * time_ratio[i] * norm;
+          sum_sites += range.length;
+        }
+      }
+    }
+
+    const double site_cost = sum_sites > 0 ? sum_cost / sum_sites : full_range.site_cost;
+    result.assign_sites(full_range.part_id, full_range.start, full_range.length, site_cost);
+  }
+
+  return result;
+}
+
+double estimated_imbalance(const PartitionAssignmentList& part_assign,
+                           const std::vector<double>& capacities)
+{
+  assert(capacities.empty() || capacities.size() == part_assign.size());
+
+  double max_time = 0., total_cost = 0., total_capacity = 0.;
+  for (size_t i = 0; i < part_assign.size(); ++i)
+  {
+    const double cap = capacities.empty() ? 1. : capacities[i];
+    max_time = max(max_time, part_assign[i].cost() / cap);
+    total_cost += part_assign[i].cost();
+    total_capacity += cap;
+  }
+
+  return total_cost > 0. ? max_time * total_capacity / total_cost : 1.;
+}
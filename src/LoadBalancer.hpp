@@ -1,8 +1,18 @@
 #ifndef RAXML_LOADBALANCER_HPP_
 #define RAXML_LOADBALANCER_HPP_
 
+#include <memory>
+#include <string>
+
 #include "PartitionAssignment.hpp"
 
+enum class LoadBalancerType
+{
+  kassian = 0,
+  simple,
+  makespan
+};
+
 class LoadBalancer
 {
 public:
@@ -10,13 +20,24 @@ public:
   virtual
   ~LoadBalancer ();
 
+  static std::unique_ptr<LoadBalancer> create(LoadBalancerType type);
+
   PartitionAssignmentList get_all_assignments(const PartitionAssignment& part_sizes,
                                               size_t num_procs);
 
   PartitionAssignment get_proc_assignments(const PartitionAssignment& part_sizes,
                                            size_t num_procs, size_t proc_id);
 
+  /* relative speed of every thread (heterogeneous cores): thread i gets a share of
+   * capacities[i] / sum(capacities) of the total cost. Empty: all threads are equally fast */
+  void capacities(const std::vector<double>& capacities) { _capacities = capacities; }
+  const std::vector<double>& capacities() const { return _capacities; }
+
 protected:
+  std::vector<double> _capacities;
+
+  double capacity(size_t proc_id) const { return _capacities.empty() ? 1. : _capacities[proc_id]; }
+
   virtual PartitionAssignmentList compute_assignments(const PartitionAssignment& part_sizes,
                                                       size_t num_procs) = 0;
 };
@@ -35,4 +56,48 @@ protected:
                                                       size_t num_procs);
 };
 
+/*
+ * Minimizes the estimated makespan (cost of the most loaded thread), where every partition
+ * slice has a fixed overhead on top of its per-site cost (p-matrix updates, derivative
+ * pre-computation, per-partition steps of model optimization). Partitions are only split if
+ * they are larger than the average load; chunks are assigned by LPT (largest first to the least
+ * loaded thread), followed by a local search which moves, swaps or splits chunks between the
+ * most and the least loaded threads.
+ */
+class MakespanLoadBalancer : public LoadBalancer
+{
+public:
+  /* slice_overhead: fixed cost of a slice, in sites of the same partition */
+  MakespanLoadBalancer(double slice_overhead = 50.) : _slice_overhead(slice_overhead) {}
+
+  double slice_overhead() const { return _slice_overhead; }
+
+  /* estimated cost of the most loaded thread (divided by its capacity), including slice
+   * overheads */
+  double makespan(const PartitionAssignmentList& part_assign) const;
+
+protected:
+  virtual PartitionAssignmentList compute_assignments(const PartitionAssignment& part_sizes,
+                                                      size_t num_procs);
+
+private:
+  double _slice_overhead;
+};
+
+std::string load_balancer_name(LoadBalancerType type);
+
+/* runtime feedback: rescale the per-site costs in part_sizes such that they match the measured
+ * computation times of the given assignments (one time value per assignment). If given,
+ * capacities are the relative speeds of the threads the times were measured on */
+PartitionAssignment calibrate_site_costs(const PartitionAssignment& part_sizes,
+                                         const PartitionAssignmentList& assignments,
+                                         const std::vector<double>& times,
+                                         const std::vector<double>& capacities =
+                                             std::vector<double>());
+
+/* highest cost / capacity ratio among threads, relative to the ideal one (total cost / total
+ * capacity); equal to PartitionAssignmentStats::imbalance() if capacities are empty */
+double estimated_imbalance(const PartitionAssignmentList& part_assign,
+                           const std::vector<double>& capacities);
+
 #endif /* RAXML_LOADBALANCER_HPP_ */
@@ -6,7 +6,7 @@
 using namespace std;
 
 MSA::MSA(const pll_msa_t *pll_msa) :
-    _length(0), _num_sites(pll_msa->length), _states(0), _pll_msa(nullptr)
+    _length(0), _num_sites(pll_msa->length), _seq_offset(0), _states(0), _pll_msa(nullptr)
 {
   for (auto i = 0; i < pll_msa->count; ++i)
   {
@@ -16,13 +16,19 @@ MSA::MSA(const pll_msa_t *pll_msa) :
   update_pll_msa();
 }
 
+MSA::MSA(size_t num_sites, WeightVector&& weights, size_t seq_offset) :
+    _length(weights.size()), _num_sites(num_sites), _seq_offset(seq_offset),
+    _weights(move(weights)), _states(0), _pll_msa(nullptr), _dirty(false)
+{
+}
+
 MSA::MSA(MSA&& other) : _length(other._length), _num_sites(other._num_sites),
-    _sequences(move(other._sequences)), _labels(move(other._labels)),
+    _seq_offset(other._seq_offset), _sequences(move(other._sequences)), _labels(move(other._labels)),
     _label_id_map(move(other._label_id_map)), _weights(move(other._weights)),
     _probs(move(other._probs)), _states(other._states), _pll_msa(other._pll_msa),
     _dirty(other._dirty)
 {
-  other._length = other._num_sites = 0;
+  other._length = other._num_sites = other._seq_offset = 0;
   other._pll_msa = nullptr;
   other._dirty = false;
 };
@@ -46,6 +52,7 @@ MSA& MSA::operator=(MSA&& other)
     // steal other’s resource
     _length = other._length;
     _num_sites = other._num_sites;
+    _seq_offset = other._seq_offset;
     _pll_msa = other._pll_msa;
     _weights = std::move(other._weights);
     _sequences = std::move(other._sequences);
@@ -56,7 +63,7 @@ MSA& MSA::operator=(MSA&& other)
     _dirty = other._dirty;
 
     // reset other
-    other._length = other._num_sites = other._states = 0;
+    other._length = other._num_sites = other._seq_offset = other._states = 0;
     other._pll_msa = nullptr;
     other._dirty = false;
   }
@@ -77,7 +84,8 @@ void MSA::free_pll_msa() noexcept
 
 void MSA::append(const string& sequence, const string& header)
 {
-  if(_length && sequence.length() != (size_t) _length)
+  /* NB: compare with first sequence, since _length refers to the whole alignment for slices */
+  if(!_sequences.empty() && sequence.length() != _sequences.front().length())
     throw runtime_error{string("Tried to insert sequence to MSA of unequal length: ") + sequence};
 
   _sequences.push_back(sequence);
@@ -136,6 +144,9 @@ void MSA::update_pll_msa() const
 
   assert(_labels.empty() || _labels.size() == _sequences.size());
 
+  /* NB: libpll can't handle alignment slices */
+  assert(_seq_offset == 0);
+
   if (_dirty)
   {
     _pll_msa->count = size();
@@ -19,9 +19,12 @@ public:
   typedef typename container::iterator        iterator;
   typedef typename container::const_iterator  const_iterator;
 
-  MSA() : _length(0), _num_sites(0), _states(0), _pll_msa(NULL), _dirty(false) {};
-  MSA(const unsigned int num_sites) : _length(0), _num_sites(num_sites),
+  MSA() : _length(0), _num_sites(0), _seq_offset(0), _states(0), _pll_msa(NULL), _dirty(false) {};
+  MSA(const unsigned int num_sites) : _length(0), _num_sites(num_sites), _seq_offset(0),
       _states(0), _pll_msa(nullptr), _dirty(false) {};
+  /* alignment slice: sequences hold only the columns starting at seq_offset, whereas
+   * length(), weights() etc. refer to the whole (compressed) alignment */
+  MSA(size_t num_sites, WeightVector&& weights, size_t seq_offset);
   MSA(const pll_msa_t * pll_msa);
   MSA(MSA&& other);
   MSA(const MSA& other) = delete;
@@ -38,6 +41,7 @@ public:
   size_t length() const { return _length; }
   size_t num_sites() const { return _num_sites; }
   size_t num_patterns() const { return _weights.size(); }
+  size_t seq_offset() const { return _seq_offset; }
   const WeightVector& weights() const {return _weights; }
   const NameIdMap& label_id_map() const { return _label_id_map; }
   const pll_msa_t * pll_msa() const;
@@ -75,6 +79,7 @@ private:
   // Data Members
   size_t _length;
   size_t _num_sites;
+  size_t _seq_offset;
   container _sequences;
   container _labels;
   NameIdMap _label_id_map;
@@ -0,0 +1,113 @@
+#include <assert.h>
+#include <cmath>
+
+#include "ModelOptScheduler.hpp"
+
+using namespace std;
+
+std::atomic<unsigned long long> ModelOptScheduler::_total_steps(0);
+std::atomic<unsigned long long> ModelOptScheduler::_skipped_steps(0);
+
+bool ModelOptScheduler::converged(size_t part_id, int param) const
+{
+  if (!_enabled)
+    return false;
+
+  auto it = _converged.find(param);
+  return it != _converged.end() && part_id < it->second.size() && it->second[part_id];
+}
+
+void ModelOptScheduler::update(size_t part_id, int param, double change, double gain,
+                               double lh_epsilon)
+{
+  auto& part_converged = _converged[param];
+  if (part_converged.size() <= part_id)
+    part_converged.resize(part_id + 1, 0);
+
+  part_converged[part_id] = change < RAXML_MODOPT_MIN_CHANGE ||
+      gain < RAXML_MODOPT_MIN_GAIN * lh_epsilon;
+}
+
+doubleVector ModelOptScheduler::param_values(const pllmod_treeinfo_t& treeinfo, size_t part_id,
+                                             int param)
+{
+  const pll_partition_t * partition = treeinfo.partitions[part_id];
+  doubleVector values;
+
+  if (!partition)
+    return values;
+
+  switch (param)
+  {
+    case PLLMOD_OPT_PARAM_SUBST_RATES:
+    {
+      const unsigned int num_rates = partition->states * (partition->states - 1) / 2;
+      for (size_t m = 0; m < partition->rate_matrices; ++m)
+        values.insert(values.end(), partition->subst_params[m],
+                      partition->subst_params[m] + num_rates);
+      break;
+    }
+    case PLLMOD_OPT_PARAM_FREQUENCIES:
+      for (size_t m = 0; m < partition->rate_matrices; ++m)
+        values.insert(values.end(), partition->frequencies[m],
+                      partition->frequencies[m] + partition->states);
+      break;
+    case PLLMOD_OPT_PARAM_ALPHA:
+      values.push_back(treeinfo.alphas[part_id]);
+      break;
+    case PLLMOD_OPT_PARAM_PINV:
+      values.assign(partition->prop_invar, partition->prop_invar + partition->rate_matrices);
+      break;
+    case PLLMOD_OPT_PARAM_FREE_RATES:
+      values.assign(partition->rates, partition->rates + partition->rate_cats);
+      values.insert(values.end(), partition->rate_weights,
+                    partition->rate_weights + partition->rate_cats);
+      break;
+    default:
+      throw runtime_error("Unsupported parameter for adaptive model optimization: " +
+                          to_string(param));
+  }
+
+  return values;
+}
+
+double ModelOptScheduler::param_change(const doubleVector& old_values,
+                                       const doubleVector& new_values)
+{
+  assert(old_values.size() == new_values.size());
+
+  double change = 0.;
+  for (size_t i = 0; i < old_values.size(); ++i)
+  {
+    const double diff = fabs(new_values[i] - old_values[i]);
+    const double scale = max(fabs(old_values[i]), RAXML_DOUBLE_TOLERANCE);
+    change = max(change, diff / scale);
+  }
+
+  return change;
+}
+
+std::string ModelOptScheduler::param_name(int param)
+{
+  switch (param)
+  {
+    case PLLMOD_OPT_PARAM_SUBST_RATES:
+      return "rates";
+    case PLLMOD_OPT_PARAM_FREQUENCIES:
+      return "freqs";
+    case PLLMOD_OPT_PARAM_ALPHA:
+      return "alpha";
+    case PLLMOD_OPT_PARAM_PINV:
+      return "p-inv";
+    case PLLMOD_OPT_PARAM_FREE_RATES:
+      return "freeR";
+    default:
+      return "param " + to_string(param);
+  }
+}
+
+void ModelOptScheduler::count_steps(size_t total, size_t skipped)
+{
+  _total_steps += total;
+  _skipped_steps += skipped;
+}
@@ -0,0 +1,55 @@
+#ifndef RAXML_MODELOPTSCHEDULER_HPP_
+#define RAXML_MODELOPTSCHEDULER_HPP_
+
+#include <atomic>
+
+#include "common.h"
+
+/*
+ * Adaptive model optimization: records how much each parameter class (substitution rates,
+ * frequencies, alpha, p-inv, free rates) of each partition changed in its last optimization
+ * step, and how much logLH this step gained. Converged classes are excluded from subsequent
+ * optimization passes until reset(), which should be called whenever the topology changes.
+ *
+ * NB: all threads of a group must take the same decisions, so the recorded values must be
+ * reduced over the group before calling update().
+ */
+class ModelOptScheduler
+{
+public:
+  ModelOptScheduler() : _enabled(false) {}
+  explicit ModelOptScheduler(bool enabled) : _enabled(enabled) {}
+
+  bool enabled() const { return _enabled; }
+
+  /* forget all convergence information */
+  void reset() { _converged.clear(); }
+
+  bool converged(size_t part_id, int param) const;
+
+  /* record the outcome of an optimization step of param in partition part_id:
+   * relative change of the parameter values and total logLH gain of the step */
+  void update(size_t part_id, int param, double change, double gain, double lh_epsilon);
+
+  /* current values of a parameter class in a (local) partition */
+  static doubleVector param_values(const pllmod_treeinfo_t& treeinfo, size_t part_id, int param);
+
+  /* largest relative difference between old and new values */
+  static double param_change(const doubleVector& old_values, const doubleVector& new_values);
+
+  static std::string param_name(int param);
+
+  /* statistics: partition-level optimization steps requested/skipped (over all groups) */
+  static void count_steps(size_t total, size_t skipped);
+  static unsigned long long total_steps() { return _total_steps; }
+  static unsigned long long skipped_steps() { return _skipped_steps; }
+
+private:
+  bool _enabled;
+  std::unordered_map<int, std::vector<char>> _converged;   /* param -> partitions */
+
+  static std::atomic<unsigned long long> _total_steps;
+  static std::atomic<unsigned long long> _skipped_steps;
+};
+
+#endif /* RAXML_MODELOPTSCHEDULER_HPP_ */
@@ -2,8 +2,61 @@
 
 using namespace std;
 
+/* topology convergence: compares the bipartitions (as bit vectors) of the trees obtained
+ * after consecutive SPR rounds */
+class TopologyTracker
+{
+public:
+  TopologyTracker() : _splits(nullptr), _stable_rounds(0) {}
+  ~TopologyTracker() { clear(); }
+
+  /* start a new SPR phase from the current tree */
+  void reset(const TreeInfo& treeinfo)
+  {
+    clear();
+    _splits = create_splits(treeinfo);
+    _stable_rounds = 0;
+  }
+
+  /* returns number of consecutive rounds with RF distance 0 to the previous tree */
+  unsigned int update(const TreeInfo& treeinfo)
+  {
+    pll_split_t * splits = create_splits(treeinfo);
+    const unsigned int tip_count = treeinfo.pll_treeinfo().tip_count;
+
+    if (_splits && pllmod_utree_split_rf_distance(_splits, splits, tip_count) == 0)
+      _stable_rounds++;
+    else
+      _stable_rounds = 0;
+
+    clear();
+    _splits = splits;
+
+    return _stable_rounds;
+  }
+
+private:
+  pll_split_t * _splits;
+  unsigned int _stable_rounds;
+
+  static pll_split_t * create_splits(const TreeInfo& treeinfo)
+  {
+    unsigned int n_splits;
+    return pllmod_utree_split_create((pll_unode_t*) &treeinfo.pll_utree_root(),
+                                     treeinfo.pll_treeinfo().tip_count, &n_splits, nullptr);
+  }
+
+  void clear()
+  {
+    if (_splits)
+      pllmod_utree_split_destroy(_splits);
+    _splits = nullptr;
+  }
+};
+
 Optimizer::Optimizer (const Options &opts) :
-    _lh_epsilon(opts.lh_epsilon), _spr_radius(opts.spr_radius), _spr_cutoff(opts.spr_cutoff)
+    _lh_epsilon(opts.lh_epsilon), _spr_radius(opts.spr_radius), _spr_cutoff(opts.spr_cutoff),
+    _spr_converge(opts.spr_converge), _stop_step(CheckpointStep::finish)
 {
 }
 
@@ -27,6 +80,7 @@ double Optimizer::optimize(TreeInfo& treeinfo, double lh_epsilon)
 
     treeinfo.optimize_params_all(lh_epsilon);
 
+    /* NB: usually cached by TreeInfo, i.e. no extra traversal */
     new_loglh = treeinfo.loglh();
 
 //      printf("old: %f, new: %f\n", cur_loglh, new_loglh);
@@ -46,7 +100,7 @@ double Optimizer::optimize_topology(TreeInfo& treeinfo, CheckpointManager& cm)
   const double interim_modopt_eps = 3.;
 
   SearchState local_search_state = cm.search_state();
-  auto& search_state = ParallelContext::master_thread() ? cm.search_state() : local_search_state;
+  auto& search_state = ParallelContext::group_master_thread() ? cm.search_state() : local_search_state;
   ParallelContext::barrier();
 
   /* set references such that we can work directly with checkpoint values */
@@ -57,12 +111,16 @@ double Optimizer::optimize_topology(TreeInfo& treeinfo, CheckpointManager& cm)
 
   CheckpointStep resume_step = search_state.step;
 
+  /* measure thread work times from the beginning */
+  if (_rebalance_cb)
+    ParallelContext::work_timer_start();
+
   /* Compute initial LH of the starting tree */
   loglh = treeinfo.loglh();
 
-  auto do_step = [&search_state,resume_step](CheckpointStep step) -> bool
+  auto do_step = [&search_state,resume_step,this](CheckpointStep step) -> bool
       {
-        if (step >= resume_step)
+        if (step >= resume_step && step < _stop_step)
         {
           search_state.step = step;
           return true;
@@ -148,6 +206,9 @@ double Optimizer::optimize_topology(TreeInfo& treeinfo, CheckpointManager& cm)
   {
     cm.update_and_write(treeinfo);
 
+    if (_rebalance_cb)
+      _rebalance_cb(treeinfo);
+
     /* optimize model parameters a bit more thoroughly */
     LOG_PROGRESS(loglh) << "Model parameter optimization (eps = " <<
                                                             interim_modopt_eps << ")" << endl;
@@ -166,9 +227,13 @@ double Optimizer::optimize_topology(TreeInfo& treeinfo, CheckpointManager& cm)
   }
 
   double old_loglh;
+  TopologyTracker topology;
 
   if (do_step(CheckpointStep::fastSPR))
   {
+    if (_spr_converge)
+      topology.reset(treeinfo);
+
     do
     {
       cm.update_and_write(treeinfo);
@@ -180,6 +245,16 @@ double Optimizer::optimize_topology(TreeInfo& treeinfo, CheckpointManager& cm)
 
       /* optimize ALL branches */
       loglh = treeinfo.optimize_branches(_lh_epsilon, 1);
+
+      /* NB: all threads see the same tree, so they take the same decision */
+      if (_spr_converge && topology.update(treeinfo) >= _spr_converge &&
+          loglh - old_loglh > _lh_epsilon)
+      {
+        LOG_PROGRESS(loglh) << "Topology unchanged for " << _spr_converge <<
+            " rounds, skipping remaining FAST spr rounds (last logLH gain: " <<
+            FMT_LH(loglh - old_loglh) << ")" << endl;
+        break;
+      }
     }
     while (loglh - old_loglh > _lh_epsilon);
   }
@@ -187,6 +262,9 @@ double Optimizer::optimize_topology(TreeInfo& treeinfo, CheckpointManager& cm)
   if (do_step(CheckpointStep::modOpt3))
   {
     cm.update_and_write(treeinfo);
+
+    if (_rebalance_cb)
+      _rebalance_cb(treeinfo);
     LOG_PROGRESS(loglh) << "Model parameter optimization (eps = " << 1.0 << ")" << endl;
     loglh = optimize(treeinfo, 1.0);
 
@@ -199,6 +277,9 @@ double Optimizer::optimize_topology(TreeInfo& treeinfo, CheckpointManager& cm)
 
   if (do_step(CheckpointStep::slowSPR))
   {
+    if (_spr_converge)
+      topology.reset(treeinfo);
+
     do
     {
       cm.update_and_write(treeinfo);
@@ -226,6 +307,17 @@ double Optimizer::optimize_topology(TreeInfo& treeinfo, CheckpointManager& cm)
         spr_params.radius_min = spr_params.radius_max + 1;
         spr_params.radius_max += radius_step;
       }
+
+      if (_spr_converge && topology.update(treeinfo) >= _spr_converge &&
+          spr_params.radius_min < radius_limit)
+      {
+        /* NB: lower bound, assuming no further improvements */
+        const int rounds_left = (radius_limit - spr_params.radius_min + radius_step - 1) /
+            radius_step;
+        LOG_PROGRESS(loglh) << "Topology unchanged for " << _spr_converge <<
+            " rounds, skipping at least " << rounds_left << " remaining SLOW spr round(s)" << endl;
+        break;
+      }
     }
     while (spr_params.radius_min >= 0 && spr_params.radius_min < radius_limit);
   }
@@ -238,8 +330,12 @@ double Optimizer::optimize_topology(TreeInfo& treeinfo, CheckpointManager& cm)
     loglh = optimize(treeinfo, _lh_epsilon);
   }
 
-  if (do_step(CheckpointStep::finish))
-    cm.update_and_write(treeinfo);
+  /* NB: if stopped early, the (group) checkpoint holds everything needed to continue from here */
+  search_state.step = _stop_step;
+  cm.update_and_write(treeinfo);
+
+  if (_rebalance_cb)
+    ParallelContext::work_timer_stop();
 
   return loglh;
 }
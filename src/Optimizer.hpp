@@ -4,6 +4,8 @@
 #include "TreeInfo.hpp"
 #include "Checkpoint.hpp"
 
+#include <functional>
+
 class Optimizer
 {
 public:
@@ -14,10 +16,22 @@ public:
   double optimize(TreeInfo& treeinfo, double lh_epsilon);
   double optimize(TreeInfo& treeinfo) { return optimize(treeinfo, _lh_epsilon); };
   double optimize_topology(TreeInfo& treeinfo, CheckpointManager& cm);
+
+  /* runtime load balancing: called by all threads after the checkpoint update at the
+   * beginning of modOpt2 and modOpt3 steps, might replace treeinfo */
+  typedef std::function<void(TreeInfo&)> RebalanceCallback;
+  void rebalance_cb(const RebalanceCallback& cb) { _rebalance_cb = cb; }
+
+  /* racing multi-start search: optimize_topology() returns as soon as the given step is
+   * reached, and can be resumed from the checkpointed search state later */
+  void stop_step(CheckpointStep step) { _stop_step = step; }
 private:
   double _lh_epsilon;
   int _spr_radius;
   double _spr_cutoff;
+  unsigned int _spr_converge;
+  RebalanceCallback _rebalance_cb;
+  CheckpointStep _stop_step;
 };
 
 #endif /* RAXML_OPTIMIZER_H_ */
@@ -23,6 +23,8 @@ void Options::set_default_outfiles()
   set_default_outfile(outfile_names.ml_trees, "mlTrees");
   set_default_outfile(outfile_names.bootstrap_trees, "bootstraps");
   set_default_outfile(outfile_names.support_tree, "support");
+  set_default_outfile(outfile_names.load_balance, "loadBalance");
+  set_default_outfile(outfile_names.part_assign, "partAssign");
 }
 
 bool Options::result_files_exist()
@@ -76,6 +78,9 @@ std::ostream& operator<<(std::ostream& stream, const Options& opts)
     case Command::all:
       stream << "ML tree search + bootstrapping";
       break;
+    case Command::balance:
+      stream << "Load balance planning";
+      break;
     default:
       break;
   }
@@ -113,6 +118,15 @@ std::ostream& operator<<(std::ostream& stream, const Options& opts)
       stream << "  spr subtree cutoff: " << opts.spr_cutoff << endl;
     else
       stream << "  spr subtree cutoff: OFF" << endl;
+
+    if (opts.spr_converge > 0)
+    {
+      stream << "  spr convergence: topology unchanged for " << opts.spr_converge <<
+          " rounds" << endl;
+    }
+
+    if (opts.spr_memo)
+      stream << "  spr memo: ON" << endl;
   }
 
   stream << "  branch lengths: ";
@@ -126,6 +140,8 @@ std::ostream& operator<<(std::ostream& stream, const Options& opts)
 
   stream << ")" << endl;
 
+  if (opts.optimize_model && opts.adaptive_modopt)
+    stream << "  adaptive model optimization: ON" << endl;
 
   stream << "  SIMD kernels: " << get_simd_arch_name(opts.simd_arch) << endl;
 
@@ -133,7 +149,8 @@ std::ostream& operator<<(std::ostream& stream, const Options& opts)
   if (opts.num_ranks > 1 && opts.num_threads > 1)
   {
     stream << "hybrid MPI+PTHREADS (" << opts.num_ranks <<  " ranks x " <<
-        opts.num_threads <<  " threads)" << endl;
+        opts.num_threads <<  " threads, " <<
+        (opts.mpi_thread_multiple ? "multiple" : "funneled") << ")" << endl;
   }
   else if (opts.num_ranks > 1)
     stream <<  "MPI (" << opts.num_ranks << " ranks)" << endl;
@@ -142,6 +159,51 @@ std::ostream& operator<<(std::ostream& stream, const Options& opts)
   else
     stream << "NONE/sequential" << endl;
 
+  if (opts.num_workers == 0)
+    stream << "  parallel tree searches: auto" << endl;
+  else if (opts.num_workers > 1)
+  {
+    stream << "  parallel tree searches: " << opts.num_workers << " workers x " <<
+        opts.num_threads / opts.num_workers << " threads" << endl;
+  }
+
+  if (opts.num_ranks > 1 && opts.mpi_bs_queue && opts.num_bootstraps > 0)
+    stream << "  bootstrap replicates: dynamic (MPI job queue)" << endl;
+
+  if (opts.clv_task_threads > 1)
+  {
+    stream << "  task-parallel CLV updates: " << opts.clv_task_threads << " threads per " <<
+        "data slice" << endl;
+  }
+
+  if (opts.num_threads * opts.num_ranks > 1)
+    stream << "  load balancer: " << load_balancer_name(opts.load_balancer) << endl;
+
+  if (opts.num_threads > 1 && opts.rebalance_threshold > 0.)
+    stream << "  runtime load balancing: imbalance > " << opts.rebalance_threshold << endl;
+
+  if (opts.race_lh_diff != 0. && opts.num_searches > 1)
+  {
+    stream << "  racing starting trees: cull after FAST SPR if logLH < best - ";
+    if (opts.race_lh_diff < 0.)
+      stream << "auto";
+    else
+      stream << opts.race_lh_diff;
+    stream << ", keep at least " << opts.race_keep << endl;
+  }
+
+  if (opts.num_threads > 1 && opts.spr_mode != SprMode::automatic)
+  {
+    stream << "  parallel SPR rounds: " <<
+        (opts.spr_mode == SprMode::candidates ? "candidates" : "sites") << endl;
+  }
+
+  if (opts.num_threads > 1)
+    stream << "  thread barrier: " << barrier_mode_name(opts.barrier_mode) << endl;
+
+  if (opts.pin_mode != PinMode::none)
+    stream << "  thread pinning: " << pin_mode_name(opts.pin_mode) << endl;
+
   stream << endl;
 
   return stream;
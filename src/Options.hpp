@@ -3,6 +3,7 @@
 
 #include "common.h"
 #include "PartitionedMSA.hpp"
+#include "LoadBalancer.hpp"
 
 struct OutputFileNames
 {
@@ -13,6 +14,8 @@ struct OutputFileNames
   std::string ml_trees;
   std::string bootstrap_trees;
   std::string support_tree;
+  std::string load_balance;     /* --balance-only: statistics per processor count */
+  std::string part_assign;      /* --balance-only: data distribution per processor count */
 };
 
 class Options
@@ -23,10 +26,13 @@ public:
   optimize_model(true), optimize_brlen(true), redo_mode(false), log_level(LogLevel::progress),
   msa_format(FileFormat::autodetect), data_type(DataType::autodetect),
   random_seed(0), start_tree(StartingTree::random), lh_epsilon(DEF_LH_EPSILON), spr_radius(-1),
-  spr_cutoff(1.0), brlen_linkage(PLLMOD_TREE_BRLEN_SCALED), simd_arch(PLL_ATTRIB_ARCH_CPU),
+  spr_cutoff(1.0), spr_converge(0), spr_memo(false), adaptive_modopt(false), brlen_linkage(PLLMOD_TREE_BRLEN_SCALED), simd_arch(PLL_ATTRIB_ARCH_CPU),
   num_searches(1), num_bootstraps(100),
   tree_file(""), msa_file(""), model_file(""), outfile_prefix(""),
-  num_threads(1), num_ranks(1)
+  num_threads(1), num_ranks(1), num_workers(1), barrier_mode(BarrierMode::adaptive),
+  pin_mode(PinMode::none), mpi_thread_multiple(false), mpi_bs_queue(false),
+  clv_task_threads(1), rebalance_threshold(0.), load_balancer(LoadBalancerType::kassian),
+  spr_mode(SprMode::automatic), race_lh_diff(0.), race_keep(1), benchmark(BenchmarkType::none)
   {};
 
   ~Options() = default;
@@ -53,6 +59,9 @@ public:
   double lh_epsilon;
   int spr_radius;
   double spr_cutoff;
+  unsigned int spr_converge;    /* stop SPR phase if topology is unchanged for N rounds (0=off) */
+  bool spr_memo;                /* skip prune nodes without improving moves in the last round */
+  bool adaptive_modopt;         /* skip converged model parameters in later optimization passes */
   int brlen_linkage;
   unsigned int simd_arch;
 
@@ -69,6 +78,19 @@ public:
   /* parallelization stuff */
   unsigned int num_threads;     /* number of threads */
   unsigned int num_ranks;       /* number of MPI ranks */
+  unsigned int num_workers;     /* number of thread groups working on different trees (0=auto) */
+  BarrierMode barrier_mode;     /* thread barrier implementation */
+  PinMode pin_mode;             /* thread-to-core pinning strategy */
+  bool mpi_thread_multiple;     /* hybrid mode: all threads talk to MPI (MPI_THREAD_MULTIPLE) */
+  bool mpi_bs_queue;            /* MPI ranks pull bootstrap replicates from rank 0 on demand */
+  unsigned int clv_task_threads;  /* threads sharing a data slice (task-parallel CLV updates) */
+  double rebalance_threshold;   /* re-distribute data if measured max/avg thread time exceeds it (0=off) */
+  LoadBalancerType load_balancer; /* strategy for distributing partitions among threads */
+  SprMode spr_mode;             /* threads split alignment sites or SPR candidates */
+  double race_lh_diff;          /* racing multi-start search: culling threshold (0=off, <0=auto) */
+  unsigned int race_keep;       /* racing: minimum number of starting trees to finish */
+
+  BenchmarkType benchmark;      /* micro-benchmark to run (--bench) */
 
   std::string output_fname(const std::string& suffix) const;
 
@@ -79,6 +101,8 @@ public:
   const std::string& ml_trees_file() const { return outfile_names.ml_trees; }
   const std::string& bootstrap_trees_file() const { return outfile_names.bootstrap_trees; }
   const std::string& support_tree_file() const { return outfile_names.support_tree; }
+  const std::string& load_balance_file() const { return outfile_names.load_balance; }
+  const std::string& part_assign_file() const { return outfile_names.part_assign; }
 
   void set_default_outfiles();
 
@@ -0,0 +1,357 @@
+#include <algorithm>
+#include <chrono>
+#include <atomic>
+
+#include "ParallelBenchmark.hpp"
+#include "ThreadPinning.hpp"
+#include "Options.hpp"
+
+using namespace std;
+
+#define BENCH_MIN_THREADS     2
+#define BENCH_MAX_THREADS     64
+#define BENCH_MAX_SECONDS     1.0
+#define BENCH_MAX_ITERS       200000
+
+/* legacy barrier: distance between the per-thread cycle flags (one cache line) */
+#define BENCH_CYCLE_STRIDE    (RAXML_CACHE_LINE_SIZE / sizeof(int))
+
+/* threads check the time limit only every BENCH_CHECK_INTERVAL barriers */
+#define BENCH_CHECK_INTERVAL  64
+
+#define BENCH_REDUCE_ITERS    2000
+#define BENCH_REDUCE_WARMUP   50
+
+/* synthetic partition for the CLV kernel benchmark */
+#define BENCH_CLV_PATTERNS    1024
+#define BENCH_CLV_STATES      4
+#define BENCH_CLV_RATECATS    4
+
+double benchmark_clv_kernel(double min_seconds)
+{
+  typedef chrono::steady_clock clock;
+
+  const size_t span = BENCH_CLV_STATES * BENCH_CLV_RATECATS;
+  const size_t matrix_size = BENCH_CLV_STATES * BENCH_CLV_STATES;
+  vector<double> left(BENCH_CLV_PATTERNS * span, 0.3), right(BENCH_CLV_PATTERNS * span, 0.7);
+  vector<double> parent(BENCH_CLV_PATTERNS * span);
+  vector<double> lmat(BENCH_CLV_RATECATS * matrix_size, 0.25);
+  vector<double> rmat(BENCH_CLV_RATECATS * matrix_size, 0.25);
+
+  /* a (scalar) CLV update loop similar to the libpll one */
+  size_t reps = 0;
+  double secs = 0.;
+  auto start = clock::now();
+  do
+  {
+    for (size_t n = 0; n < BENCH_CLV_PATTERNS; ++n)
+    {
+      for (size_t k = 0; k < BENCH_CLV_RATECATS; ++k)
+      {
+        const double * lm = lmat.data() + k * matrix_size;
+        const double * rm = rmat.data() + k * matrix_size;
+        const double * lclv = left.data() + n * span + k * BENCH_CLV_STATES;
+        const double * rclv = right.data() + n * span + k * BENCH_CLV_STATES;
+        double * pclv = parent.data() + n * span + k * BENCH_CLV_STATES;
+        for (size_t i = 0; i < BENCH_CLV_STATES; ++i)
+        {
+          double lterm = 0., rterm = 0.;
+          for (size_t j = 0; j < BENCH_CLV_STATES; ++j)
+          {
+            lterm += lm[i * BENCH_CLV_STATES + j] * lclv[j];
+            rterm += rm[i * BENCH_CLV_STATES + j] * rclv[j];
+          }
+          pclv[i] = lterm * rterm;
+        }
+      }
+
+      /* NB: the result is fed back below, so rescale it (like libpll's CLV scaling) to keep
+       * values in the normal range; otherwise we'd end up timing denormal arithmetic */
+      double * pclv = parent.data() + n * span;
+      const double max_entry = *max_element(pclv, pclv + span);
+      if (max_entry > 0.)
+      {
+        const double factor = 1. / max_entry;
+        for (size_t i = 0; i < span; ++i)
+          pclv[i] *= factor;
+      }
+    }
+    /* feed the result back to prevent the compiler from optimizing the loop away */
+    left.swap(parent);
+    reps++;
+    secs = chrono::duration<double>(clock::now() - start).count();
+  }
+  while (secs < min_seconds);
+
+  const double units = (double) reps * BENCH_CLV_PATTERNS * span * BENCH_CLV_STATES;
+  return secs * 1e9 / units;
+}
+
+std::vector<double> benchmark_cpu_clv_kernel(const std::vector<int>& cpus, double min_seconds)
+{
+#ifdef _RAXML_PTHREADS
+  const size_t num_threads = cpus.size();
+  vector<double> nsec(num_threads, 0.);
+
+  ThreadBarrier barrier(num_threads, BarrierMode::block);
+  auto worker = [&](size_t thread_id)
+    {
+      /* NB: failure is not fatal, we'll just measure an unpinned thread */
+      pin_current_thread(cpus[thread_id]);
+
+      /* start all kernels at the same time, so that they compete for shared resources
+       * (caches, memory bandwidth, SMT siblings, power budget) as they will later */
+      barrier.wait();
+      nsec[thread_id] = benchmark_clv_kernel(min_seconds);
+    };
+
+  vector<thread> threads;
+  for (size_t t = 0; t < num_threads; ++t)
+    threads.emplace_back(worker, t);
+
+  for (auto& t: threads)
+    t.join();
+
+  return nsec;
+#else
+  UNUSED(cpus);
+  UNUSED(min_seconds);
+  throw runtime_error("CPU benchmark requires PTHREADS support!");
+#endif
+}
+
+#ifdef _RAXML_PTHREADS
+/* the original thread barrier (baseline): thread 0 busy-waits until all threads arrived and
+ * flips the proceed flag, all other threads busy-wait on it */
+class LegacyBarrier
+{
+public:
+  LegacyBarrier(size_t num_threads) : _num_threads(num_threads), _counter(0), _proceed(0),
+    _cycles(num_threads * BENCH_CYCLE_STRIDE, 0) {}
+
+  void wait(size_t thread_id)
+  {
+    /* NB: was thread_local in the original, padded here to avoid false sharing */
+    volatile int& my_cycle = _cycles[thread_id * BENCH_CYCLE_STRIDE];
+
+    __sync_fetch_and_add(&_counter, 1);
+
+    if (thread_id == 0)
+    {
+      while (_counter != _num_threads);
+      _counter = 0;
+      _proceed = !_proceed;
+    }
+    else
+    {
+      while (my_cycle == _proceed);
+      my_cycle = !my_cycle;
+    }
+  }
+
+private:
+  size_t _num_threads;
+  volatile unsigned int _counter;
+  volatile int _proceed;
+  vector<int> _cycles;
+};
+
+/* adapter, such that both barriers can be timed by the same loop */
+struct ModeBarrier
+{
+  ModeBarrier(size_t num_threads, BarrierMode mode) : barrier(num_threads, mode) {}
+
+  void wait(size_t thread_id) { UNUSED(thread_id); barrier.wait(); }
+
+  ThreadBarrier barrier;
+};
+
+template<typename Barrier>
+static double time_barrier(size_t num_threads, Barrier& barrier, double max_seconds,
+                           size_t max_iters)
+{
+  typedef chrono::steady_clock clock;
+
+  atomic<bool> stop(false);
+  size_t total_iters = 0;
+  double total_secs = 0.;
+
+  auto worker = [&](size_t thread_id)
+    {
+      /* make sure all threads are up and running before we start the clock */
+      barrier.wait(thread_id);
+
+      auto start = clock::now();
+      size_t i = 0;
+      for (;;)
+      {
+        const bool check = (i % BENCH_CHECK_INTERVAL == BENCH_CHECK_INTERVAL - 1);
+
+        /* the stop flag is only written right before and read right after a "check"
+         * barrier, so that all threads leave the loop after the same iteration */
+        if (check && thread_id == 0)
+        {
+          chrono::duration<double> secs = clock::now() - start;
+          if (secs.count() > max_seconds || i + 1 >= max_iters)
+            stop.store(true);
+        }
+
+        barrier.wait(thread_id);
+        ++i;
+
+        if (check && stop.load())
+          break;
+      }
+
+      if (thread_id == 0)
+      {
+        chrono::duration<double> secs = clock::now() - start;
+        total_secs = secs.count();
+        total_iters = i;
+      }
+    };
+
+  vector<thread> threads;
+  for (size_t t = 1; t < num_threads; ++t)
+    threads.emplace_back(worker, t);
+
+  worker(0);
+
+  for (auto& t: threads)
+    t.join();
+
+  return total_secs * 1e6 / total_iters;
+}
+#endif
+
+double benchmark_thread_barrier(size_t num_threads, BarrierMode mode,
+                                double max_seconds, size_t max_iters)
+{
+#ifdef _RAXML_PTHREADS
+  ModeBarrier barrier(num_threads, mode);
+  return time_barrier(num_threads, barrier, max_seconds, max_iters);
+#else
+  UNUSED(num_threads);
+  UNUSED(mode);
+  UNUSED(max_seconds);
+  UNUSED(max_iters);
+  throw runtime_error("Thread barrier benchmark requires PTHREADS support!");
+#endif
+}
+
+double benchmark_legacy_barrier(size_t num_threads, double max_seconds, size_t max_iters)
+{
+#ifdef _RAXML_PTHREADS
+  LegacyBarrier barrier(num_threads);
+  return time_barrier(num_threads, barrier, max_seconds, max_iters);
+#else
+  UNUSED(num_threads);
+  UNUSED(max_seconds);
+  UNUSED(max_iters);
+  throw runtime_error("Thread barrier benchmark requires PTHREADS support!");
+#endif
+}
+
+static void run_barrier_benchmark()
+{
+  const BarrierMode modes[] = {BarrierMode::spin, BarrierMode::adaptive, BarrierMode::block};
+
+  LOG_INFO << "Thread barrier latency (microseconds per barrier), hardware threads: " <<
+      thread::hardware_concurrency() << endl << endl;
+
+  LOG_INFO << setw(8) << "threads" << setw(12) << "legacy";
+  for (auto mode: modes)
+    LOG_INFO << setw(12) << barrier_mode_name(mode);
+  LOG_INFO << endl;
+
+  for (size_t num_threads = BENCH_MIN_THREADS; num_threads <= BENCH_MAX_THREADS; num_threads *= 2)
+  {
+    LOG_INFO << setw(8) << num_threads;
+
+    /* NB: the legacy barrier never yields, so it would livelock on oversubscribed cores */
+    if (num_threads <= thread::hardware_concurrency())
+    {
+      double usec = benchmark_legacy_barrier(num_threads, BENCH_MAX_SECONDS, BENCH_MAX_ITERS);
+      LOG_INFO << setw(12) << FMT_PREC3(usec);
+    }
+    else
+      LOG_INFO << setw(12) << "-";
+
+    for (auto mode: modes)
+    {
+      double usec = benchmark_thread_barrier(num_threads, mode, BENCH_MAX_SECONDS,
+                                             BENCH_MAX_ITERS);
+      LOG_INFO << setw(12) << FMT_PREC3(usec);
+    }
+    LOG_INFO << endl;
+  }
+  LOG_INFO << endl;
+}
+
+double benchmark_rank_reduce(size_t size, bool hierarchical, size_t num_iters)
+{
+  typedef chrono::steady_clock clock;
+
+  vector<double> data(size);
+
+  for (size_t i = 0; i < BENCH_REDUCE_WARMUP; ++i)
+    ParallelContext::rank_reduce(data.data(), size, PLLMOD_TREE_REDUCE_SUM, hierarchical);
+
+  ParallelContext::mpi_barrier();
+
+  auto start = clock::now();
+  for (size_t i = 0; i < num_iters; ++i)
+  {
+    /* NB: values don't matter, but keep them from growing too large */
+    std::fill(data.begin(), data.end(), 1.);
+    ParallelContext::rank_reduce(data.data(), size, PLLMOD_TREE_REDUCE_SUM, hierarchical);
+  }
+  chrono::duration<double> secs = clock::now() - start;
+
+  double usec = secs.count() * 1e6 / num_iters;
+  ParallelContext::rank_reduce(&usec, 1, PLLMOD_TREE_REDUCE_MAX, false);
+
+  return usec;
+}
+
+static void run_reduce_benchmark()
+{
+  if (ParallelContext::num_ranks() < 2)
+    throw runtime_error("Reduction benchmark requires MPI with at least 2 ranks!");
+
+  /* typical reduction sizes: logLH/derivatives for a single partition, and per-partition
+   * vectors for the model parameter optimizers on partitioned datasets */
+  const size_t sizes[] = {1, 2, 4, 16, 128, 1024, 8192};
+
+  LOG_INFO << "MPI allreduce latency (microseconds), " << ParallelContext::num_ranks() <<
+      " ranks on " << ParallelContext::num_nodes() << " node(s), current mode: " <<
+      (ParallelContext::mpi_hierarchical() ? "hierarchical" : "flat") << endl << endl;
+
+  LOG_INFO << setw(8) << "doubles" << setw(14) << "flat" << setw(14) << "hierarchical" <<
+      setw(10) << "speedup" << endl;
+
+  for (auto size: sizes)
+  {
+    double flat_usec = benchmark_rank_reduce(size, false, BENCH_REDUCE_ITERS);
+    double hier_usec = benchmark_rank_reduce(size, true, BENCH_REDUCE_ITERS);
+
+    LOG_INFO << setw(8) << size << setw(14) << FMT_PREC3(flat_usec) <<
+        setw(14) << FMT_PREC3(hier_usec) << setw(10) << FMT_PREC3(flat_usec / hier_usec) << endl;
+  }
+  LOG_INFO << endl;
+}
+
+void run_benchmark(const Options& opts)
+{
+  switch (opts.benchmark)
+  {
+    case BenchmarkType::barrier:
+      run_barrier_benchmark();
+      break;
+    case BenchmarkType::reduce:
+      run_reduce_benchmark();
+      break;
+    default:
+      throw runtime_error("Unknown benchmark type!");
+  }
+}
@@ -0,0 +1,28 @@
+#ifndef RAXML_PARALLELBENCHMARK_HPP_
+#define RAXML_PARALLELBENCHMARK_HPP_
+
+#include "common.h"
+
+class Options;
+
+/* micro-benchmarks for the parallelization primitives (--bench) */
+void run_benchmark(const Options& opts);
+
+/* average latency of a single ThreadBarrier::wait() call, in microseconds */
+double benchmark_thread_barrier(size_t num_threads, BarrierMode mode,
+                                double max_seconds, size_t max_iters);
+
+/* same for the original busy-wait barrier (baseline) */
+double benchmark_legacy_barrier(size_t num_threads, double max_seconds, size_t max_iters);
+
+/* average latency of a reduction across MPI ranks (slowest rank), in microseconds */
+double benchmark_rank_reduce(size_t size, bool hierarchical, size_t num_iters);
+
+/* time of one CLV entry update per (state x state x rate category) in nanoseconds, measured
+ * with a scalar CLV kernel on a small synthetic partition for at least min_seconds */
+double benchmark_clv_kernel(double min_seconds);
+
+/* same as above, measured concurrently on each of the given CPUs by threads pinned to them */
+std::vector<double> benchmark_cpu_clv_kernel(const std::vector<int>& cpus, double min_seconds);
+
+#endif /* RAXML_PARALLELBENCHMARK_HPP_ */
@@ -4,28 +4,102 @@
 
 using namespace std;
 
-// TODO: estimate based on #threads and #partitions?
+/* minimum size of collective buffers; they will grow as needed */
 #define PARALLEL_BUF_SIZE (128 * 1024)
 
+/* rough estimate of the serialized model size, used for the initial gather buffer size */
+#define PARALLEL_MODEL_SIZE_ESTIMATE 1024
+
+/* minimum number of vector elements per thread to use slice-parallel reduction */
+#define PARALLEL_REDUCE_MIN_SLICE 32
+
+/* MPI tag for job queue results (all other messages use tag 0) */
+#define PARALLEL_TAG_RESULT 1
+
 size_t ParallelContext::_num_threads = 1;
 size_t ParallelContext::_num_ranks = 1;
 size_t ParallelContext::_rank_id = 0;
+bool ParallelContext::_mpi_thread_multiple = false;
+size_t ParallelContext::_num_nodes = 1;
+bool ParallelContext::_mpi_hierarchical = false;
+bool ParallelContext::_mpi_job_queue = false;
+unsigned long ParallelContext::_job_counter = 0;
 thread_local size_t ParallelContext::_thread_id = 0;
+thread_local size_t ParallelContext::_local_thread_id = 0;
+thread_local ThreadGroup * ParallelContext::_thread_group = nullptr;
+thread_local bool ParallelContext::_thread_placed = false;
+thread_local size_t ParallelContext::_collective_epoch = 0;
+thread_local std::vector<const char *> ParallelContext::_reduce_scopes;
+thread_local std::vector<ParallelContext::QueuedReduce> ParallelContext::_reduce_queue;
+thread_local std::vector<double> ParallelContext::_fused_buf;
+thread_local bool ParallelContext::_work_timer_active = false;
+thread_local double ParallelContext::_work_timer_last = 0.;
+thread_local double ParallelContext::_work_time = 0.;
 std::vector<ThreadType> ParallelContext::_threads;
-std::vector<char> ParallelContext::_parallel_buf;
+ThreadBarrier ParallelContext::_thread_barrier;
+std::vector<std::unique_ptr<ThreadGroup>> ParallelContext::_thread_groups;
+PinMode ParallelContext::_pin_mode = PinMode::none;
+std::unique_ptr<CpuTopology> ParallelContext::_cpu_topology;
+std::vector<int> ParallelContext::_thread_cpus;
+size_t ParallelContext::_pin_node_rank = 0;
+size_t ParallelContext::_pin_node_ranks = 1;
+std::vector<char> ParallelContext::_gather_buf;
+ParallelBufferStats ParallelContext::_buf_stats = ParallelBufferStats();
+ParallelReduceStats ParallelContext::_reduce_stats = ParallelReduceStats();
+std::map<std::string, ParallelReduceCounter> ParallelContext::_reduce_counters;
 std::unordered_map<ThreadIDType, ParallelContext> ParallelContext::_thread_ctx_map;
 MutexType ParallelContext::mtx;
+#ifdef _RAXML_MPI
+std::vector<MPI_Comm> ParallelContext::_thread_comms;
+MPI_Comm ParallelContext::_node_comm = MPI_COMM_NULL;
+MPI_Comm ParallelContext::_leader_comm = MPI_COMM_NULL;
+int ParallelContext::_node_rank = 0;
+MPI_Win ParallelContext::_job_win = MPI_WIN_NULL;
+std::vector<char> ParallelContext::_send_buf;
+MPI_Request ParallelContext::_send_req = MPI_REQUEST_NULL;
+#endif
 
 void ParallelContext::init_mpi(int argc, char * argv[])
 {
 #ifdef _RAXML_MPI
   {
+    /* NB: MPI must be initialized before the command line is parsed, so we have to check
+     * for the requested threading mode here */
+    bool want_multiple = false;
+    for (int i = 1; i < argc; ++i)
+    {
+      const string arg = argv[i];
+      if ((arg == "--mpi-threads" && i + 1 < argc && strcasecmp(argv[i+1], "multiple") == 0) ||
+          strcasecmp(arg.c_str(), "--mpi-threads=multiple") == 0)
+        want_multiple = true;
+    }
+
     int tmp;
-    MPI_Init(&argc, &argv);
+    MPI_Init_thread(&argc, &argv, want_multiple ? MPI_THREAD_MULTIPLE : MPI_THREAD_FUNNELED, &tmp);
+
+    /* fall back to funneled mode if MPI library doesn't support concurrent calls */
+    _mpi_thread_multiple = want_multiple && tmp >= MPI_THREAD_MULTIPLE;
+
     MPI_Comm_rank(MPI_COMM_WORLD, &tmp);
     _rank_id = (size_t) tmp;
     MPI_Comm_size(MPI_COMM_WORLD, &tmp);
     _num_ranks = (size_t) tmp;
+
+    /* ranks sharing a node, and the lowest rank of every node ("leader") */
+    MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, (int) _rank_id, MPI_INFO_NULL,
+                        &_node_comm);
+    MPI_Comm_rank(_node_comm, &_node_rank);
+    MPI_Comm_split(MPI_COMM_WORLD, _node_rank == 0 ? 0 : MPI_UNDEFINED, (int) _rank_id,
+                   &_leader_comm);
+
+    tmp = 0;
+    if (_leader_comm != MPI_COMM_NULL)
+      MPI_Comm_size(_leader_comm, &tmp);
+    MPI_Bcast(&tmp, 1, MPI_INT, 0, _node_comm);
+    _num_nodes = (size_t) tmp;
+
+    /* two-level reduction only pays off if there are multiple nodes with multiple ranks */
+    _mpi_hierarchical = _num_nodes > 1 && _num_nodes < _num_ranks;
 //    printf("size: %lu, rank: %lu\n", _num_ranks, _rank_id);
   }
 #else
@@ -36,14 +110,136 @@ void ParallelContext::init_mpi(int argc, char * argv[])
 
 void ParallelContext::start_thread(size_t thread_id, const std::function<void()>& thread_main)
 {
+  /* NB: thread group will be set by update_thread_group() once the master is done
+   * with the initialization */
   ParallelContext::_thread_id = thread_id;
   thread_main();
 }
 
+void ParallelContext::set_thread_group(size_t thread_id)
+{
+  /* groups comprise consecutive thread IDs */
+  const size_t threads_per_group = _num_threads / _thread_groups.size();
+  _thread_group = _thread_groups.at(thread_id / threads_per_group).get();
+  _local_thread_id = thread_id % threads_per_group;
+}
+
+void ParallelContext::init_thread_groups(size_t num_groups, BarrierMode barrier_mode)
+{
+  assert(num_groups > 0 && _num_threads % num_groups == 0);
+
+  _thread_groups.clear();
+  for (size_t i = 0; i < num_groups; ++i)
+  {
+    _thread_groups.emplace_back(new ThreadGroup(i, _num_threads / num_groups, barrier_mode));
+    _thread_groups.back()->reduce_buf.resize(PARALLEL_BUF_SIZE);
+  }
+
+  /* thread placement depends on group layout */
+  if (_cpu_topology)
+  {
+    _thread_cpus = compute_thread_cpus(*_cpu_topology, _pin_mode, _num_threads, num_groups,
+                                       _pin_node_rank, _pin_node_ranks);
+  }
+
+  /* NB: master thread will be pinned in update_thread_group(), until then threads spawned
+   * by the master (workers, benchmarks) can be freely placed by OS */
+  set_thread_group(_thread_id);
+}
+
+void ParallelContext::update_thread_group()
+{
+  set_thread_group(_thread_id);
+
+  /* NB: pin before the thread allocates its CLVs etc., such that first-touch policy
+   * places them in the local NUMA node */
+  if (!_thread_cpus.empty())
+  {
+    /* NB: failure is not fatal, thread will just run unpinned */
+    pin_current_thread(_thread_cpus.at(_thread_id));
+    _thread_placed = true;
+  }
+}
+
+std::string ParallelContext::thread_layout()
+{
+  if (!_cpu_topology || _thread_cpus.empty())
+    return "";
+
+  string layout = pin_mode_name(_pin_mode) + ", " + thread_layout_str(*_cpu_topology, _thread_cpus);
+  if (_pin_node_ranks > 1)
+  {
+    layout += "\n    CPUs shared by " + to_string(_pin_node_ranks) + " ranks on this node, " +
+        "using share #" + to_string(_pin_node_rank + 1);
+  }
+
+  return layout;
+}
+
+void ParallelContext::detect_shared_cpus()
+{
+  _pin_node_rank = 0;
+  _pin_node_ranks = 1;
+
+#ifdef _RAXML_MPI
+  int node_ranks = 1;
+  if (_node_comm != MPI_COMM_NULL)
+    MPI_Comm_size(_node_comm, &node_ranks);
+
+  if (node_ranks < 2)
+    return;
+
+  /* NB: if the launcher bound the ranks to disjoint CPU sets, they will see different CPUs;
+   * otherwise, all ranks of the node would pin their threads to the same CPUs */
+  unsigned long long cpu_set[2] = {_cpu_topology->num_cpus(), 0};
+  for (const auto& cpu: _cpu_topology->cpus())
+    cpu_set[1] = cpu_set[1] * 1000003ULL + (unsigned long long) cpu.id;
+
+  vector<unsigned long long> node_cpu_sets(2 * node_ranks);
+  MPI_Allgather(cpu_set, 2, MPI_UNSIGNED_LONG_LONG, node_cpu_sets.data(), 2,
+                MPI_UNSIGNED_LONG_LONG, _node_comm);
+
+  for (int i = 0; i < node_ranks; ++i)
+  {
+    if (node_cpu_sets[2 * i] != cpu_set[0] || node_cpu_sets[2 * i + 1] != cpu_set[1])
+      return;
+  }
+
+  _pin_node_rank = (size_t) _node_rank;
+  _pin_node_ranks = (size_t) node_ranks;
+#endif
+}
+
 void ParallelContext::init_pthreads(const Options& opts, const std::function<void()>& thread_main)
 {
   _num_threads = opts.num_threads;
-  _parallel_buf.reserve(PARALLEL_BUF_SIZE);
+  _gather_buf.resize(PARALLEL_BUF_SIZE);
+  _thread_barrier.reset(_num_threads, opts.barrier_mode);
+
+  _pin_mode = opts.pin_mode;
+  if (_pin_mode != PinMode::none)
+  {
+    _cpu_topology.reset(new CpuTopology());
+    detect_shared_cpus();
+  }
+
+  /* NB: num_workers = 0 means "auto", groups will be re-initialized later */
+  init_thread_groups(max<size_t>(opts.num_workers, 1), opts.barrier_mode);
+
+#ifdef _RAXML_MPI
+  _mpi_thread_multiple = _mpi_thread_multiple && opts.mpi_thread_multiple &&
+                         _num_ranks > 1 && _num_threads > 1;
+  if (_mpi_thread_multiple)
+  {
+    /* private communicator for every thread index: collectives on distinct communicators
+     * can safely run concurrently */
+    _thread_comms.resize(_num_threads);
+    for (auto& comm: _thread_comms)
+      MPI_Comm_dup(MPI_COMM_WORLD, &comm);
+  }
+#else
+  _mpi_thread_multiple = false;
+#endif
 
 #ifdef _RAXML_PTHREADS
   /* Launch threads */
@@ -73,6 +269,15 @@ void ParallelContext::finalize(bool force)
   else
     MPI_Barrier(MPI_COMM_WORLD);
 
+  for (auto& comm: _thread_comms)
+    MPI_Comm_free(&comm);
+  _thread_comms.clear();
+
+  if (_leader_comm != MPI_COMM_NULL)
+    MPI_Comm_free(&_leader_comm);
+  if (_node_comm != MPI_COMM_NULL)
+    MPI_Comm_free(&_node_comm);
+
   MPI_Finalize();
 #endif
 }
@@ -80,7 +285,9 @@ void ParallelContext::finalize(bool force)
 void ParallelContext::barrier()
 {
 #ifdef _RAXML_MPI
-  mpi_barrier();
+  /* NB: in job queue mode, ranks are not synchronized with each other */
+  if (group_ranks() > 1)
+    mpi_barrier();
 #endif
 
 #ifdef _RAXML_PTHREADS
@@ -98,170 +305,715 @@ void ParallelContext::mpi_barrier()
 
 void ParallelContext::thread_barrier()
 {
-  static volatile unsigned int barrier_counter = 0;
-  static thread_local volatile int myCycle = 0;
-  static volatile int proceed = 0;
+  if (_thread_group)
+  {
+    /* time spent waiting for other threads doesn't count as work */
+    if (_work_timer_active)
+    {
+      _work_time += sysutil_gettime() - _work_timer_last;
+      _thread_group->barrier.wait();
+      _work_timer_last = sysutil_gettime();
+    }
+    else
+      _thread_group->barrier.wait();
+  }
+}
+
+void ParallelContext::work_timer_start()
+{
+  _work_time = 0.;
+  _work_timer_last = sysutil_gettime();
+  _work_timer_active = true;
+}
+
+void ParallelContext::work_timer_stop()
+{
+  if (_work_timer_active)
+    _work_time += sysutil_gettime() - _work_timer_last;
+  _work_timer_active = false;
+}
+
+double ParallelContext::work_time()
+{
+  return _work_timer_active ? _work_time + sysutil_gettime() - _work_timer_last : _work_time;
+}
+
+void ParallelContext::global_thread_barrier()
+{
+  _thread_barrier.wait();
+}
+
+static size_t round_up(size_t size, size_t multiple)
+{
+  return ((size + multiple - 1) / multiple) * multiple;
+}
+
+static void grow_buffer(std::vector<char>& buf, size_t size, size_t& resize_count)
+{
+  /* grow geometrically to avoid frequent reallocations */
+  buf.resize(max(size, 2 * buf.size()));
+  resize_count++;
+}
+
+void ParallelContext::resize_buffers(size_t part_count)
+{
+  /* largest vector reduced by libpll: 2 doubles per partition (e.g., derivatives);
+   * buffer half holds one padded slot per thread plus the result area */
+  const size_t reduce_half_size = (group_threads() + 1) *
+      round_up(2 * part_count * sizeof(double), RAXML_CACHE_LINE_SIZE);
+  const size_t reduce_buf_size = max((size_t) PARALLEL_BUF_SIZE, 2 * reduce_half_size);
 
-  __sync_fetch_and_add( &barrier_counter, 1);
+  /* gather: each worker rank sends the models of (roughly) its share of partitions */
+  const size_t rank_parts = _num_ranks > 1 ? (part_count + _num_ranks - 1) / _num_ranks + 1 : 0;
+  const size_t gather_buf_size = max((size_t) PARALLEL_BUF_SIZE,
+                                     rank_parts * PARALLEL_MODEL_SIZE_ESTIMATE);
 
-  if(_thread_id == 0)
+  for (auto& group: _thread_groups)
   {
-    while(barrier_counter != ParallelContext::_num_threads);
-    barrier_counter = 0;
-    proceed = !proceed;
+    if (reduce_buf_size > group->reduce_buf.size())
+      grow_buffer(group->reduce_buf, reduce_buf_size, group->resize_count);
   }
-  else
+
+  if (gather_buf_size > _gather_buf.size())
+    grow_buffer(_gather_buf, gather_buf_size, _buf_stats.resize_count);
+}
+
+ParallelBufferStats ParallelContext::buffer_stats()
+{
+  ParallelBufferStats stats = _buf_stats;
+  for (const auto& group: _thread_groups)
   {
-    while(myCycle == proceed);
-    myCycle = !myCycle;
+    stats.reduce_buf_size = max(stats.reduce_buf_size, group->reduce_buf.size());
+    stats.reduce_buf_peak = max(stats.reduce_buf_peak, group->reduce_buf_peak);
+    stats.resize_count += group->resize_count;
   }
+  stats.gather_buf_size = _gather_buf.size();
+  return stats;
 }
 
-void ParallelContext::thread_reduce(double * data, size_t size, int op)
+void ParallelContext::reserve_collective_buf(size_t size)
 {
-  /* synchronize */
-  thread_barrier();
+  /* NB: all threads of the group must call this function with the same size, hence they
+   * take the same decision and either all or none of them enter the resize block */
+  auto& group = *_thread_group;
+  if (2 * size > group.reduce_buf.size())
+  {
+    /* make sure no thread is still reading the buffer from the previous collective */
+    thread_barrier();
 
-  double *double_buf = (double*) _parallel_buf.data();
+    if (_local_thread_id == 0)
+      grow_buffer(group.reduce_buf, 2 * size, group.resize_count);
 
-  /* collect data from threads */
-  size_t i, j;
-  for (i = 0; i < size; ++i)
-    double_buf[_thread_id * size + i] = data[i];
+    thread_barrier();
+  }
 
-  /* synchronize */
-  thread_barrier();
+  if (_local_thread_id == 0)
+    group.reduce_buf_peak = max(group.reduce_buf_peak, 2 * size);
+}
 
-  /* reduce */
-  for (i = 0; i < size; ++i)
+char * ParallelContext::collective_buf()
+{
+  /* collectives alternate between two halves of the shared buffer: this way, the data of
+   * the previous collective can still be read by slow threads while the fast ones already
+   * write to the buffer. NB: this is safe as long as every collective has a barrier
+   * between its writes and reads, and all threads take part in every collective */
+  auto& reduce_buf = _thread_group->reduce_buf;
+  const size_t half_size = reduce_buf.size() / 2;
+  char * buf = (char *) reduce_buf.data() + (_collective_epoch % 2) * half_size;
+  _collective_epoch++;
+  return buf;
+}
+
+static void reduce_slots(const double * slots, size_t slot_stride, size_t num_slots,
+                         size_t start, size_t end, double * result, int op)
+{
+  for (size_t i = start; i < end; ++i)
+    result[i] = slots[i];
+
+  for (size_t j = 1; j < num_slots; ++j)
   {
+    const double * slot = slots + j * slot_stride;
     switch(op)
     {
       case PLLMOD_TREE_REDUCE_SUM:
-      {
-        data[i] = 0.;
-        for (j = 0; j < ParallelContext::_num_threads; ++j)
-          data[i] += double_buf[j * size + i];
-      }
-      break;
+        for (size_t i = start; i < end; ++i)
+          result[i] += slot[i];
+        break;
       case PLLMOD_TREE_REDUCE_MAX:
-      {
-        data[i] = _parallel_buf[i];
-        for (j = 1; j < ParallelContext::_num_threads; ++j)
-          data[i] = max(data[i], double_buf[j * size + i]);
-      }
-      break;
+        for (size_t i = start; i < end; ++i)
+          result[i] = max(result[i], slot[i]);
+        break;
       case PLLMOD_TREE_REDUCE_MIN:
-      {
-        data[i] = _parallel_buf[i];
-        for (j = 1; j < ParallelContext::_num_threads; ++j)
-          data[i] = min(data[i], double_buf[j * size + i]);
-      }
-      break;
+        for (size_t i = start; i < end; ++i)
+          result[i] = min(result[i], slot[i]);
+        break;
+      default:
+        assert(0);
     }
   }
+}
 
-  //needed?
-//  parallel_barrier(useropt);
+void ParallelContext::thread_reduce(double * data, size_t size, int op)
+{
+  thread_reduce(data, size, op, false);
 }
 
+void ParallelContext::thread_reduce(double * data, size_t size, int op, bool mpi_reduce)
+{
+  /*
+   * Buffer layout: one slot per thread (padded to a multiple of the cache line size),
+   * followed by the result vector. Reduction and broadcast are fused: every thread reads the
+   * final result directly from the shared buffer.
+   */
+  const size_t num_threads = _thread_group->num_threads;
+  const size_t line_dbl = RAXML_CACHE_LINE_SIZE / sizeof(double);
+  const size_t slot_stride = round_up(size, line_dbl);
+
+  reserve_collective_buf((num_threads + 1) * slot_stride * sizeof(double));
+
+  double * slots = (double *) collective_buf();
+  double * result = slots + num_threads * slot_stride;
+
+  /* put local data into this thread's slot */
+  memcpy(slots + _local_thread_id * slot_stride, data, size * sizeof(double));
+
+  /* synchronize */
+  thread_barrier();
+
+  const bool use_slices = size >= num_threads * PARALLEL_REDUCE_MIN_SLICE;
+  if (use_slices)
+  {
+    /* large vector: each thread reduces its own (cache line-aligned) slice */
+    size_t slice = (size + num_threads - 1) / num_threads;
+    slice = round_up(slice, line_dbl);
+    const size_t start = min(size, _local_thread_id * slice);
+    const size_t end = min(size, start + slice);
+
+    reduce_slots(slots, slot_stride, num_threads, start, end, result, op);
+
+#ifdef _RAXML_MPI
+    /* MPI_THREAD_MULTIPLE: every thread reduces its own slice across ranks. NB: slicing is
+     * identical on all ranks, so threads with an empty slice can skip the collective */
+    if (mpi_reduce && _mpi_thread_multiple && end > start)
+      mpi_allreduce(result + start, end - start, op, _thread_comms[_local_thread_id]);
+#endif
+
+    /* wait until all slices are reduced */
+    thread_barrier();
+  }
+  else if (!mpi_reduce)
+  {
+    /* small vector: reduce it redundantly in every thread, no second barrier needed */
+    reduce_slots(slots, slot_stride, num_threads, 0, size, data, op);
+    return;
+  }
+  else if (_local_thread_id == 0)
+    reduce_slots(slots, slot_stride, num_threads, 0, size, result, op);
+
+#ifdef _RAXML_MPI
+  if (mpi_reduce && !(use_slices && _mpi_thread_multiple))
+  {
+    /* funneled mode or small vector: single collective on thread 0 */
+    if (_local_thread_id == 0)
+      mpi_allreduce(result, size, op);
+
+    thread_barrier();
+  }
+#endif
+
+  memcpy(data, result, size * sizeof(double));
+}
+
+#ifdef _RAXML_MPI
+MPI_Op ParallelContext::mpi_reduce_op(int op)
+{
+  if (op == PLLMOD_TREE_REDUCE_SUM)
+    return MPI_SUM;
+  else if (op == PLLMOD_TREE_REDUCE_MAX)
+    return MPI_MAX;
+  else if (op == PLLMOD_TREE_REDUCE_MIN)
+    return MPI_MIN;
+  else
+    assert(0);
+
+  return MPI_OP_NULL;
+}
+
+void ParallelContext::mpi_allreduce(double * data, size_t size, int op, MPI_Comm comm)
+{
+  const double start_time = MPI_Wtime();
+
+  if (comm == MPI_COMM_WORLD && _mpi_hierarchical)
+    mpi_allreduce_hierarchical(data, size, op);
+  else
+    MPI_Allreduce(MPI_IN_PLACE, data, size, MPI_DOUBLE, mpi_reduce_op(op), comm);
+
+  /* NB: with MPI_THREAD_MULTIPLE, only thread 0 updates the statistics */
+  if (_local_thread_id != 0)
+    return;
+
+  _reduce_stats.sync_count++;
+  _reduce_stats.sync_time += MPI_Wtime() - start_time;
+}
+
+void ParallelContext::mpi_allreduce_hierarchical(double * data, size_t size, int op)
+{
+  const MPI_Op mpi_op = mpi_reduce_op(op);
+
+  /* 1. reduce within node (shared memory) */
+  if (_node_rank == 0)
+    MPI_Reduce(MPI_IN_PLACE, data, size, MPI_DOUBLE, mpi_op, 0, _node_comm);
+  else
+    MPI_Reduce(data, nullptr, size, MPI_DOUBLE, mpi_op, 0, _node_comm);
+
+  /* 2. only node leaders communicate across nodes */
+  if (_leader_comm != MPI_COMM_NULL)
+    MPI_Allreduce(MPI_IN_PLACE, data, size, MPI_DOUBLE, mpi_op, _leader_comm);
+
+  /* 3. distribute result within node */
+  MPI_Bcast(data, size, MPI_DOUBLE, 0, _node_comm);
+}
+#endif
+
+void ParallelContext::rank_reduce(double * data, size_t size, int op, bool hierarchical)
+{
+#ifdef _RAXML_MPI
+  if (hierarchical)
+    mpi_allreduce_hierarchical(data, size, op);
+  else
+    MPI_Allreduce(MPI_IN_PLACE, data, size, MPI_DOUBLE, mpi_reduce_op(op), MPI_COMM_WORLD);
+#else
+  UNUSED(data);
+  UNUSED(size);
+  UNUSED(op);
+  UNUSED(hierarchical);
+#endif
+}
 
 void ParallelContext::parallel_reduce(double * data, size_t size, int op)
 {
+#ifdef _RAXML_MPI
+  if (group_ranks() > 1)
+  {
+    if (group_threads() > 1)
+    {
+      /* reduce across threads and ranks in a single pass over the shared buffer */
+      thread_reduce(data, size, op, true);
+    }
+    else
+      mpi_allreduce(data, size, op);
+
+    return;
+  }
+#endif
+
 #ifdef _RAXML_PTHREADS
-  if (_num_threads > 1)
+  if (group_threads() > 1)
     thread_reduce(data, size, op);
 #endif
+}
 
-#ifdef _RAXML_MPI
-  if (_num_ranks > 1)
+void ParallelContext::parallel_reduce_start(const double * data, size_t size, int op,
+                                            ReduceRequest& req, bool local)
+{
+  assert(!req._active);
+
+  req._buf.assign(data, data + size);
+  req._op = op;
+
+  if (group_size() == 1 || local)
+    return;
+
+  /* inside a reduction scope, a thread-level reduction (which is blocking anyway) piggybacks
+   * on the next collective. With multiple ranks, the MPI reduction is started right away
+   * instead, so that it runs in background */
+  if (!_reduce_scopes.empty() && group_ranks() == 1)
   {
-    thread_barrier();
+    _reduce_queue.push_back({req._buf.data(), size, op});
+    count_reduce(1, size, 0);
+    req._deferred = true;
+    req._active = true;
+    return;
+  }
+
+#ifdef _RAXML_PTHREADS
+  /* thread-level reduction is cheap, so do it right away */
+  if (group_threads() > 1)
+    thread_reduce(req._buf.data(), size, op);
+#endif
 
-    if (_thread_id == 0)
+#ifdef _RAXML_MPI
+  if (group_ranks() > 1)
+  {
+    if (_local_thread_id == 0)
     {
-      MPI_Op reduce_op;
-      if (op == PLLMOD_TREE_REDUCE_SUM)
-        reduce_op = MPI_SUM;
-      else if (op == PLLMOD_TREE_REDUCE_MAX)
-        reduce_op = MPI_MAX;
-      else if (op == PLLMOD_TREE_REDUCE_MIN)
-        reduce_op = MPI_MIN;
-      else
-        assert(0);
+      req._start_time = MPI_Wtime();
+      MPI_Iallreduce(MPI_IN_PLACE, req._buf.data(), size, MPI_DOUBLE, mpi_reduce_op(op),
+                     MPI_COMM_WORLD, &req._mpi_req);
+    }
+    req._active = true;
+  }
+#endif
+}
 
-#if 1
-      MPI_Allreduce(MPI_IN_PLACE, data, size, MPI_DOUBLE, reduce_op, MPI_COMM_WORLD);
-#else
-      // not sure if MPI_IN_PLACE will work in all cases...
-      MPI_Allreduce(data, _parallel_buf.data(), size, MPI_DOUBLE, reduce_op, MPI_COMM_WORLD);
-      memcpy(data, _parallel_buf.data(), size * sizeof(double));
+void ParallelContext::parallel_reduce_finish(ReduceRequest& req)
+{
+  if (!req._active)
+    return;
+
+  if (req._deferred)
+  {
+    /* NB: no-op if the request was already fused with another reduction */
+    parallel_reduce_flush();
+    req._deferred = false;
+    req._active = false;
+    return;
+  }
+
+#ifdef _RAXML_MPI
+  if (_local_thread_id == 0)
+  {
+    const double wait_start = MPI_Wtime();
+    MPI_Wait(&req._mpi_req, MPI_STATUS_IGNORE);
+    const double wait_end = MPI_Wtime();
+
+    /* we can't tell exactly when the reduction completed, so estimate the hidden communication
+     * time as the time in flight, capped by the average duration of a blocking reduction */
+    const double inflight_time = wait_start - req._start_time;
+    const double sync_avg = _reduce_stats.sync_count ?
+        _reduce_stats.sync_time / _reduce_stats.sync_count : inflight_time;
+
+    _reduce_stats.async_count++;
+    _reduce_stats.async_wait_time += wait_end - wait_start;
+    _reduce_stats.async_hidden_time += min(inflight_time, sync_avg);
+  }
+
+  /* distribute the result among the group threads */
+  thread_broadcast(0, req._buf.data(), req._buf.size() * sizeof(double));
 #endif
+
+  req._active = false;
+}
+
+void ParallelContext::count_reduce(size_t calls, size_t elements, size_t collectives)
+{
+  /* NB: counters are not synchronized, so we only collect them on the master thread */
+  if (_thread_id != 0)
+    return;
+
+  auto& counter = _reduce_counters[_reduce_scopes.empty() ? "other" : _reduce_scopes.back()];
+  counter.calls += calls;
+  counter.elements += elements;
+  counter.collectives += collectives;
+}
+
+void ParallelContext::fused_reduce(double * data, size_t size, int op)
+{
+  size_t fused_size = size;
+  for (const auto& q: _reduce_queue)
+  {
+    if (q.op == op)
+      fused_size += q.size;
+  }
+
+  if (group_size() > 1)
+    count_reduce(0, 0, 1);
+
+  if (fused_size == size)
+  {
+    parallel_reduce(data, size, op);
+    return;
+  }
+
+  /* concatenate queued vectors of the same type and reduce them in a single collective */
+  _fused_buf.resize(fused_size);
+  double * buf = _fused_buf.data();
+  if (size > 0)
+    memcpy(buf, data, size * sizeof(double));
+  size_t offset = size;
+  for (const auto& q: _reduce_queue)
+  {
+    if (q.op == op)
+    {
+      memcpy(buf + offset, q.data, q.size * sizeof(double));
+      offset += q.size;
     }
+  }
+
+  parallel_reduce(buf, fused_size, op);
 
-    if (_num_threads > 1)
-      thread_broadcast(0, data, size * sizeof(double));
+  if (size > 0)
+    memcpy(data, buf, size * sizeof(double));
+  offset = size;
+  for (const auto& q: _reduce_queue)
+  {
+    if (q.op == op)
+    {
+      memcpy(q.data, buf + offset, q.size * sizeof(double));
+      offset += q.size;
+    }
   }
-#endif
+
+  _reduce_queue.erase(remove_if(_reduce_queue.begin(), _reduce_queue.end(),
+                                [op](const QueuedReduce& q) { return q.op == op; }),
+                      _reduce_queue.end());
+}
+
+void ParallelContext::parallel_reduce_flush()
+{
+  while (!_reduce_queue.empty())
+    fused_reduce(nullptr, 0, _reduce_queue.front().op);
+}
+
+void ParallelContext::reduce_scope_begin(const char * name)
+{
+  _reduce_scopes.push_back(name);
+}
+
+void ParallelContext::reduce_scope_end()
+{
+  assert(!_reduce_scopes.empty());
+
+  parallel_reduce_flush();
+  _reduce_scopes.pop_back();
 }
 
 void ParallelContext::parallel_reduce_cb(void * context, double * data, size_t size, int op)
 {
-  ParallelContext::parallel_reduce(data, size, op);
+  count_reduce(1, size, 0);
+  ParallelContext::fused_reduce(data, size, op);
   UNUSED(context);
 }
 
+void ParallelContext::mpi_scatter_custom(std::function<int(size_t,void*,int)> prepare_send_cb,
+                                         std::function<void(void*,int)> process_recv_cb)
+{
+#ifdef _RAXML_MPI
+  /* NB: messages can be huge (alignment data), so we use a temporary buffer here instead
+   * of the persistent _gather_buf */
+  vector<char> buf;
+  size_t resize_count = 0;
+
+  if (_rank_id == 0)
+  {
+    buf.resize(PARALLEL_BUF_SIZE);
+    for (size_t r = 1; r < _num_ranks; ++r)
+    {
+      int send_size = -1;
+      while (send_size < 0)
+      {
+        try
+        {
+          send_size = prepare_send_cb(r, buf.data(), buf.size());
+        }
+        catch (out_of_range&)
+        {
+          /* serialized data does not fit into buffer -> grow and try again */
+          grow_buffer(buf, 2 * buf.size(), resize_count);
+        }
+      }
+
+      MPI_Send(buf.data(), send_size, MPI_BYTE, r, 0, MPI_COMM_WORLD);
+    }
+  }
+  else
+  {
+    int recv_size;
+    MPI_Status status;
+    MPI_Probe(0, 0, MPI_COMM_WORLD, &status);
+    MPI_Get_count(&status, MPI_BYTE, &recv_size);
+
+    buf.resize(recv_size);
+    MPI_Recv((void*) buf.data(), recv_size, MPI_BYTE, 0, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+
+    process_recv_cb(buf.data(), recv_size);
+  }
+#else
+  UNUSED(prepare_send_cb);
+  UNUSED(process_recv_cb);
+#endif
+}
+
+void ParallelContext::mpi_broadcast(void * data, size_t size)
+{
+#ifdef _RAXML_MPI
+  if (_num_ranks > 1)
+    MPI_Bcast(data, size, MPI_BYTE, 0, MPI_COMM_WORLD);
+#else
+  UNUSED(data);
+  UNUSED(size);
+#endif
+}
+
+void ParallelContext::mpi_job_queue_begin()
+{
+  _job_counter = 0;
+
+#ifdef _RAXML_MPI
+  if (_num_ranks > 1)
+  {
+    /* NB: only rank 0 exposes the counter, other ranks access it with one-sided operations */
+    MPI_Win_create(&_job_counter, _rank_id == 0 ? sizeof(_job_counter) : 0,
+                   sizeof(_job_counter), MPI_INFO_NULL, MPI_COMM_WORLD, &_job_win);
+  }
+#endif
+
+  _mpi_job_queue = true;
+}
+
+void ParallelContext::mpi_job_queue_end()
+{
+#ifdef _RAXML_MPI
+  /* make sure the last result was delivered */
+  if (_send_req != MPI_REQUEST_NULL)
+    MPI_Wait(&_send_req, MPI_STATUS_IGNORE);
+
+  if (_job_win != MPI_WIN_NULL)
+    MPI_Win_free(&_job_win);
+#endif
+
+  _mpi_job_queue = false;
+}
+
+size_t ParallelContext::mpi_next_job()
+{
+  assert(_mpi_job_queue);
+
+#ifdef _RAXML_MPI
+  if (_job_win != MPI_WIN_NULL)
+  {
+    /* atomic fetch-and-increment: rank 0 does not have to take part */
+    const unsigned long one = 1;
+    unsigned long job_id;
+    MPI_Win_lock(MPI_LOCK_SHARED, 0, 0, _job_win);
+    MPI_Fetch_and_op(&one, &job_id, MPI_UNSIGNED_LONG, 0, 0, MPI_SUM, _job_win);
+    MPI_Win_unlock(0, _job_win);
+    return (size_t) job_id;
+  }
+#endif
+
+  return _job_counter++;
+}
+
+void ParallelContext::mpi_send_master(std::function<int(void*,int)> prepare_send_cb)
+{
+#ifdef _RAXML_MPI
+  /* previous message must be delivered before we can re-use the send buffer */
+  if (_send_req != MPI_REQUEST_NULL)
+    MPI_Wait(&_send_req, MPI_STATUS_IGNORE);
+
+  if (_send_buf.empty())
+    _send_buf.resize(PARALLEL_BUF_SIZE);
+
+  int send_size = -1;
+  while (send_size < 0)
+  {
+    try
+    {
+      send_size = prepare_send_cb(_send_buf.data(), _send_buf.size());
+    }
+    catch (out_of_range&)
+    {
+      /* serialized data does not fit into buffer -> grow and try again */
+      grow_buffer(_send_buf, 2 * _send_buf.size(), _buf_stats.resize_count);
+    }
+  }
+
+  MPI_Isend(_send_buf.data(), send_size, MPI_BYTE, 0, PARALLEL_TAG_RESULT, MPI_COMM_WORLD,
+            &_send_req);
+#else
+  UNUSED(prepare_send_cb);
+#endif
+}
+
+bool ParallelContext::mpi_recv_worker(std::function<void(void*,int,size_t)> process_recv_cb,
+                                      bool wait)
+{
+#ifdef _RAXML_MPI
+  assert(_rank_id == 0);
+
+  int pending = 0;
+  MPI_Status status;
+  if (wait)
+  {
+    MPI_Probe(MPI_ANY_SOURCE, PARALLEL_TAG_RESULT, MPI_COMM_WORLD, &status);
+    pending = 1;
+  }
+  else
+    MPI_Iprobe(MPI_ANY_SOURCE, PARALLEL_TAG_RESULT, MPI_COMM_WORLD, &pending, &status);
+
+  if (!pending)
+    return false;
+
+  int recv_size;
+  MPI_Get_count(&status, MPI_BYTE, &recv_size);
+
+  vector<char> buf(recv_size);
+  MPI_Recv((void*) buf.data(), recv_size, MPI_BYTE, status.MPI_SOURCE, PARALLEL_TAG_RESULT,
+           MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+
+  process_recv_cb(buf.data(), recv_size, (size_t) status.MPI_SOURCE);
+
+  return true;
+#else
+  UNUSED(process_recv_cb);
+  UNUSED(wait);
+  return false;
+#endif
+}
+
 void ParallelContext::thread_broadcast(size_t source_id, void * data, size_t size)
 {
+  if (group_threads() == 1)
+    return;
+
+  reserve_collective_buf(size);
+
+  char * buf = collective_buf();
+
   /* write to buf */
-  if (_thread_id == source_id)
+  if (_local_thread_id == source_id)
   {
-    memcpy((void *) _parallel_buf.data(), data, size);
+    memcpy((void *) buf, data, size);
   }
 
   /* synchronize */
   thread_barrier();
 
-//  pthread_barrier_wait(&barrier);
-  __sync_synchronize();
-
   /* read from buf*/
-  if (_thread_id != source_id)
+  if (_local_thread_id != source_id)
   {
-    memcpy(data, (void *) _parallel_buf.data(), size);
+    memcpy(data, (void *) buf, size);
   }
-
-  thread_barrier();
 }
 
 void ParallelContext::thread_send_master(size_t source_id, void * data, size_t size) const
 {
+  reserve_collective_buf(size);
+
+  char * buf = collective_buf();
+
   /* write to buf */
-  if (_thread_id == source_id && data && size)
+  if (_local_thread_id == source_id && data && size)
   {
-    memcpy((void *) _parallel_buf.data(), data, size);
+    memcpy((void *) buf, data, size);
   }
 
   /* synchronize */
   barrier();
 
-//  pthread_barrier_wait(&barrier);
-  __sync_synchronize();
-
   /* read from buf*/
-  if (_thread_id == 0)
+  if (_local_thread_id == 0)
   {
-    memcpy(data, (void *) _parallel_buf.data(), size);
+    memcpy(data, (void *) buf, size);
   }
-
-  barrier();
 }
 
 void ParallelContext::mpi_gather_custom(std::function<int(void*,int)> prepare_send_cb,
                                         std::function<void(void*,int)> process_recv_cb)
 {
 #ifdef _RAXML_MPI
-  /* we're gonna use _parallel_buf, so make sure other threads don't interfere... */
+  /* we're gonna use _gather_buf, so make sure other threads don't interfere... */
   UniqueLock lock;
 
   if (_rank_id == 0)
@@ -275,20 +1027,37 @@ void ParallelContext::mpi_gather_custom(std::function<int(void*,int)> prepare_se
 
 //      printf("recv: %lu\n", recv_size);
 
-      _parallel_buf.reserve(recv_size);
+      if ((size_t) recv_size > _gather_buf.size())
+        grow_buffer(_gather_buf, recv_size, _buf_stats.resize_count);
 
-      MPI_Recv((void*) _parallel_buf.data(), recv_size, MPI_BYTE,
+      _buf_stats.gather_buf_peak = max(_buf_stats.gather_buf_peak, (size_t) recv_size);
+
+      MPI_Recv((void*) _gather_buf.data(), recv_size, MPI_BYTE,
                r, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
 
-      process_recv_cb(_parallel_buf.data(), recv_size);
+      process_recv_cb(_gather_buf.data(), recv_size);
     }
   }
   else
   {
-    auto send_size = prepare_send_cb(_parallel_buf.data(), _parallel_buf.capacity());
+    int send_size = -1;
+    while (send_size < 0)
+    {
+      try
+      {
+        send_size = prepare_send_cb(_gather_buf.data(), _gather_buf.size());
+      }
+      catch (out_of_range&)
+      {
+        /* serialized data does not fit into buffer -> grow and try again */
+        grow_buffer(_gather_buf, 2 * _gather_buf.size(), _buf_stats.resize_count);
+      }
+    }
 //    printf("sent: %lu\n", send_size);
 
-    MPI_Send(_parallel_buf.data(), send_size, MPI_BYTE, 0, 0, MPI_COMM_WORLD);
+    _buf_stats.gather_buf_peak = max(_buf_stats.gather_buf_peak, (size_t) send_size);
+
+    MPI_Send(_gather_buf.data(), send_size, MPI_BYTE, 0, 0, MPI_COMM_WORLD);
   }
 #else
   UNUSED(prepare_send_cb);
@@ -2,8 +2,12 @@
 #define RAXML_PARALLELCONTEXT_HPP_
 
 #include <vector>
+#include <map>
+#include <string>
 #include <unordered_map>
 #include <memory>
+#include <functional>
+#include <algorithm>
 
 #ifdef _RAXML_MPI
 #include <mpi.h>
@@ -23,8 +27,80 @@ typedef int MutexType;
 typedef int LockType;
 #endif
 
+#include "ThreadBarrier.hpp"
+#include "ThreadPinning.hpp"
+
 class Options;
 
+/* a group of threads that cooperates on a single tree (fine-grained parallelization);
+ * multiple groups work on different trees concurrently (coarse-grained parallelization) */
+struct ThreadGroup
+{
+  ThreadGroup(size_t group_id, size_t num_threads, BarrierMode barrier_mode) :
+    group_id(group_id), num_threads(num_threads), barrier(num_threads, barrier_mode),
+    reduce_buf(), reduce_buf_peak(0), resize_count(0) {}
+
+  size_t group_id;
+  size_t num_threads;
+  ThreadBarrier barrier;
+  std::vector<char> reduce_buf;   /* shared buffer for group-local collectives */
+  size_t reduce_buf_peak;
+  size_t resize_count;
+};
+
+struct ParallelBufferStats
+{
+  size_t reduce_buf_size;   /* current size of the reduction/broadcast buffer */
+  size_t reduce_buf_peak;   /* high-water mark: max. size requested by a collective */
+  size_t gather_buf_size;   /* current size of the MPI gather buffer */
+  size_t gather_buf_peak;   /* high-water mark: largest message sent/received */
+  size_t resize_count;      /* number of times a buffer had to be reallocated */
+};
+
+struct ParallelReduceStats
+{
+  size_t sync_count;        /* number of blocking MPI reductions */
+  double sync_time;         /* total time spent in blocking MPI reductions (sec) */
+  size_t async_count;       /* number of non-blocking MPI reductions */
+  double async_wait_time;   /* time spent waiting for non-blocking reductions to complete */
+  double async_hidden_time; /* estimated communication time overlapped with computation */
+};
+
+/* reduction counters for a named scope, see ParallelContext::ReduceScope */
+struct ParallelReduceCounter
+{
+  size_t calls;             /* number of reductions requested */
+  size_t elements;          /* total number of vector elements reduced */
+  size_t collectives;       /* number of collectives actually issued */
+};
+
+/* handle for a non-blocking reduction, see ParallelContext::parallel_reduce_start() */
+class ReduceRequest
+{
+public:
+  ReduceRequest() : _op(0), _active(false), _deferred(false), _start_time(0.) {}
+
+  ReduceRequest(const ReduceRequest& other) = delete;
+  ReduceRequest& operator=(const ReduceRequest& other) = delete;
+
+  bool active() const { return _active; }
+
+  /* reduced vector, valid after parallel_reduce_finish() */
+  const std::vector<double>& result() const { return _buf; }
+
+private:
+  friend class ParallelContext;
+
+  std::vector<double> _buf;
+  int _op;
+  bool _active;
+  bool _deferred;
+  double _start_time;
+#ifdef _RAXML_MPI
+  MPI_Request _mpi_req;
+#endif
+};
+
 class ParallelContext
 {
 public:
@@ -33,11 +109,86 @@ public:
 
   static void finalize(bool force = false);
 
+  /* (re-)create thread groups: must be called from the master thread while other threads
+   * are waiting at the global barrier; all threads must call update_thread_group() afterwards
+   * to join their group and get pinned */
+  static void init_thread_groups(size_t num_groups, BarrierMode barrier_mode);
+  static void update_thread_group();
+
+  /* thread -> CPU assignment (empty if threads are not pinned) */
+  static const std::vector<int>& thread_cpus() { return _thread_cpus; }
+  static bool thread_placed() { return _thread_placed; }   /* pinning done (or attempted) */
+  static std::string thread_layout();
+
+  /* pre-allocate collective buffers for the given number of partitions (call from the
+   * master thread while the workers are waiting). Buffers will still grow on demand. */
+  static void resize_buffers(size_t part_count);
+  static ParallelBufferStats buffer_stats();
+
+  /* hybrid MPI+threads: true if every thread reduces its part of the data across ranks
+   * over a private communicator, false if all MPI communication goes through thread 0 */
+  static bool mpi_thread_multiple() { return _mpi_thread_multiple; }
+
+  /* number of compute nodes (shared memory domains) the MPI ranks are running on */
+  static size_t num_nodes() { return _num_nodes; }
+
+  /* true if MPI reductions are done in two steps: within node, then across node leaders */
+  static bool mpi_hierarchical() { return _mpi_hierarchical; }
+
+  /* reduce across MPI ranks only (no thread-level reduction), e.g. for benchmarking */
+  static void rank_reduce(double * data, size_t size, int op, bool hierarchical);
+
   static size_t num_procs() { return _num_ranks * _num_threads; }
   static size_t num_threads() { return _num_threads; }
   static size_t num_ranks() { return _num_ranks; }
 
+  /* thread groups: collectives and thread_barrier() are group-scoped */
+  static size_t num_groups() { return std::max<size_t>(_thread_groups.size(), 1); }
+  static size_t group_id() { return _thread_group ? _thread_group->group_id : 0; }
+  static size_t group_size() { return group_ranks() * group_threads(); }
+  static size_t local_thread_id() { return _local_thread_id; }
+  static size_t local_proc_id() { return group_rank_id() * group_threads() + _local_thread_id; }
+
+  /* number of MPI ranks which cooperate on the same tree (1 in job queue mode, see below) */
+  static size_t group_ranks() { return _mpi_job_queue ? 1 : _num_ranks; }
+
+  /* MPI job queue: every rank works on its own tree (collectives are rank-local) and pulls
+   * job indices from a shared counter on rank 0. begin/end are collective: they must be called
+   * by thread 0 of every rank while the other threads are waiting at the global barrier */
+  static void mpi_job_queue_begin();
+  static void mpi_job_queue_end();
+  static bool mpi_job_queue() { return _mpi_job_queue; }
+  static size_t mpi_next_job();
+
+  /* job queue results: worker ranks send a message to rank 0 without waiting for it to be
+   * received; rank 0 checks for pending messages (or waits for one), the callback gets the
+   * sender rank. Both must be called by the group master thread */
+  static void mpi_send_master(std::function<int(void*,int)> prepare_send_cb);
+  static bool mpi_recv_worker(std::function<void(void*,int,size_t)> process_recv_cb, bool wait);
+
   static void parallel_reduce_cb(void * context, double * data, size_t size, int op);
+
+  /* non-blocking reduction: must be called by all threads of a group; the thread-level part
+   * is completed right away, whereas the MPI part runs in background until finish is called.
+   * Other collectives may be issued in between, as long as all ranks issue them in the same order.
+   * local = true: data is already complete in every thread, nothing to reduce */
+  static void parallel_reduce_start(const double * data, size_t size, int op, ReduceRequest& req,
+                                    bool local = false);
+  static void parallel_reduce_finish(ReduceRequest& req);
+  static ParallelReduceStats reduce_stats() { return _reduce_stats; }
+
+  /* reduction scopes: within a scope, non-blocking reductions of a thread-only group are queued
+   * and fused with the next blocking reduction of the same type (or flushed together at the end
+   * of the scope); with multiple ranks, they are started as MPI_Iallreduce as usual.
+   * Scopes can be nested and must be entered/left by all threads of a group in the same order */
+  static void reduce_scope_begin(const char * name);
+  static void reduce_scope_end();
+  static void parallel_reduce_flush();
+
+  /* per-scope reduction counters (collected on the master thread only) */
+  static const std::map<std::string, ParallelReduceCounter>& reduce_counters()
+  { return _reduce_counters; }
+
   static void thread_reduce(double * data, size_t size, int op);
   static void thread_broadcast(size_t source_id, void * data, size_t size);
   void thread_send_master(size_t source_id, void * data, size_t size) const;
@@ -45,14 +196,29 @@ public:
   static void mpi_gather_custom(std::function<int(void*,int)> prepare_send_cb,
                                 std::function<void(void*,int)> process_recv_cb);
 
+  /* rank 0 prepares an individual message for every other rank (prepare_send_cb gets the
+   * target rank), other ranks receive and process it; must be called by the master thread */
+  static void mpi_scatter_custom(std::function<int(size_t,void*,int)> prepare_send_cb,
+                                 std::function<void(void*,int)> process_recv_cb);
+  static void mpi_broadcast(void * data, size_t size);
+
   static bool master() { return proc_id() == 0; }
   static bool master_rank() { return _rank_id == 0; }
   static bool master_thread() { return _thread_id == 0; }
   static size_t thread_id() { return _thread_id; }
   static size_t proc_id() { return _rank_id * _num_threads + _thread_id; }
+  static bool group_master() { return master_rank() && group_master_thread(); }
+  static bool group_master_thread() { return _local_thread_id == 0; }
+
+  /* per-thread work timer: accumulates the time spent outside of group barriers, i.e. the
+   * computation time of the calling thread (used to detect load imbalance at runtime) */
+  static void work_timer_start();
+  static void work_timer_stop();
+  static double work_time();
 
   static void barrier();
   static void thread_barrier();
+  static void global_thread_barrier();
   static void mpi_barrier();
 
   /* static singleton, no instantiation/copying/moving */
@@ -69,19 +235,82 @@ public:
   private:
     LockType _lock;
   };
+
+  class ReduceScope
+  {
+  public:
+    ReduceScope(const char * name) { reduce_scope_begin(name); }
+    ~ReduceScope() { reduce_scope_end(); }
+  };
 private:
+  struct QueuedReduce
+  {
+    double * data;
+    size_t size;
+    int op;
+  };
+
   static std::vector<ThreadType> _threads;
+  static ThreadBarrier _thread_barrier;
   static size_t _num_threads;
   static size_t _num_ranks;
-  static std::vector<char> _parallel_buf;
+  static bool _mpi_thread_multiple;
+  static size_t _num_nodes;
+  static bool _mpi_hierarchical;
+  static bool _mpi_job_queue;
+  static unsigned long _job_counter;
+  static std::vector<std::unique_ptr<ThreadGroup>> _thread_groups;
+  static PinMode _pin_mode;
+  static std::unique_ptr<CpuTopology> _cpu_topology;
+  static std::vector<int> _thread_cpus;
+  static size_t _pin_node_rank;     /* share of the CPUs to be used by this rank */
+  static size_t _pin_node_ranks;    /* number of ranks sharing the same CPUs */
+  static std::vector<char> _gather_buf;
+  static ParallelBufferStats _buf_stats;
+  static ParallelReduceStats _reduce_stats;
+  static std::map<std::string, ParallelReduceCounter> _reduce_counters;
   static std::unordered_map<ThreadIDType, ParallelContext> _thread_ctx_map;
   static MutexType mtx;
 
   static size_t _rank_id;
   static thread_local size_t _thread_id;
+  static thread_local size_t _local_thread_id;
+  static thread_local ThreadGroup * _thread_group;
+  static thread_local bool _thread_placed;
+  static thread_local size_t _collective_epoch;
+  static thread_local std::vector<const char *> _reduce_scopes;
+  static thread_local std::vector<QueuedReduce> _reduce_queue;
+  static thread_local std::vector<double> _fused_buf;
+  static thread_local bool _work_timer_active;
+  static thread_local double _work_timer_last;
+  static thread_local double _work_time;
+
+  static size_t group_threads() { return _thread_group ? _thread_group->num_threads : _num_threads; }
+  static size_t group_rank_id() { return _mpi_job_queue ? 0 : _rank_id; }
 
   static void start_thread(size_t thread_id, const std::function<void()>& thread_main);
+  static void detect_shared_cpus();
+  static void set_thread_group(size_t thread_id);
   static void parallel_reduce(double * data, size_t size, int op);
+  static void fused_reduce(double * data, size_t size, int op);
+  static void count_reduce(size_t calls, size_t elements, size_t collectives);
+  static void thread_reduce(double * data, size_t size, int op, bool mpi_reduce);
+  static char * collective_buf();
+  static void reserve_collective_buf(size_t size);
+
+#ifdef _RAXML_MPI
+  static std::vector<MPI_Comm> _thread_comms;
+  static MPI_Comm _node_comm;
+  static MPI_Comm _leader_comm;
+  static int _node_rank;
+  static MPI_Win _job_win;
+  static std::vector<char> _send_buf;
+  static MPI_Request _send_req;
+
+  static MPI_Op mpi_reduce_op(int op);
+  static void mpi_allreduce(double * data, size_t size, int op, MPI_Comm comm = MPI_COMM_WORLD);
+  static void mpi_allreduce_hierarchical(double * data, size_t size, int op);
+#endif
 };
 
 #endif /* RAXML_PARALLELCONTEXT_HPP_ */
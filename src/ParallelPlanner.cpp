@@ -0,0 +1,171 @@
+#include <chrono>
+#include <cmath>
+#include <map>
+#include <algorithm>
+
+#include "ParallelPlanner.hpp"
+#include "ParallelBenchmark.hpp"
+#include "Options.hpp"
+
+using namespace std;
+
+/* average number of CLVs updated and reductions performed per likelihood evaluation
+ * during the tree search: most evaluations are partial (SPR moves, branch optimization) */
+#define PLANNER_CLVS_PER_EVAL         4
+#define PLANNER_REDUCTIONS_PER_EVAL   4
+
+/* fraction of the physical RAM we are willing to use for CLVs */
+#define PLANNER_MEM_FRACTION          0.8
+
+/* prefer fewer, larger groups unless the gain is at least that much */
+#define PLANNER_MIN_GAIN              0.05
+
+/* treat threads as equally fast unless their speeds differ by more than that */
+#define PLANNER_MIN_SPEED_DIFF        0.1
+
+/* calibration run parameters */
+#define CALIB_MIN_SECONDS             0.02
+#define CALIB_CPU_SECONDS             0.2
+#define CALIB_BARRIER_SECONDS         0.05
+#define CALIB_BARRIER_ITERS           5000
+
+ParallelPlanner::ParallelPlanner(const Options& opts, CalibrationCache& cache) :
+    _num_threads(opts.num_threads), _barrier_mode(opts.barrier_mode), _cache(cache)
+{
+}
+
+double ParallelPlanner::clv_unit_nsec()
+{
+  const string key = "clv_unit_nsec";
+  if (_cache.has(key))
+    return _cache.get(key);
+
+  const double nsec = benchmark_clv_kernel(CALIB_MIN_SECONDS);
+
+  _cache.set(key, nsec);
+
+  return nsec;
+}
+
+doubleVector ParallelPlanner::thread_speeds(const std::vector<int>& thread_cpus)
+{
+  /* unique CPUs, and number of threads sharing each of them */
+  vector<int> cpus;
+  map<int, size_t> cpu_threads;
+  for (auto cpu: thread_cpus)
+  {
+    if (cpu_threads[cpu]++ == 0)
+      cpus.push_back(cpu);
+  }
+
+  /* NB: CPUs must be measured together (shared turbo budget etc.), so re-run the benchmark
+   * on all of them if any value is missing */
+  bool cached = true;
+  for (auto cpu: cpus)
+    cached &= _cache.has("clv_unit_nsec.cpu" + to_string(cpu));
+
+  if (!cached)
+  {
+    auto nsec = benchmark_cpu_clv_kernel(cpus, CALIB_CPU_SECONDS);
+    for (size_t i = 0; i < cpus.size(); ++i)
+      _cache.set("clv_unit_nsec.cpu" + to_string(cpus[i]), nsec[i]);
+  }
+
+  doubleVector speeds;
+  double total_speed = 0.;
+  for (auto cpu: thread_cpus)
+  {
+    const double nsec = _cache.get("clv_unit_nsec.cpu" + to_string(cpu));
+    speeds.push_back(nsec > 0. ? 1. / (nsec * cpu_threads[cpu]) : 0.);
+    total_speed += speeds.back();
+  }
+
+  if (!(total_speed > 0.))
+    return doubleVector();
+
+  for (auto& s: speeds)
+    s *= speeds.size() / total_speed;
+
+  auto minmax = minmax_element(speeds.cbegin(), speeds.cend());
+  if (*minmax.second < (1. + PLANNER_MIN_SPEED_DIFF) * *minmax.first)
+    return doubleVector();
+
+  return speeds;
+}
+
+double ParallelPlanner::reduce_usec(size_t group_size)
+{
+  if (group_size < 2)
+    return 0.;
+
+  const string key = "reduce_usec." + barrier_mode_name(_barrier_mode) + "." +
+      to_string(group_size);
+  if (_cache.has(key))
+    return _cache.get(key);
+
+  /* a small reduction costs 1-2 barriers plus some (negligible) copying */
+  const double usec = 1.5 * benchmark_thread_barrier(group_size, _barrier_mode,
+                                                     CALIB_BARRIER_SECONDS,
+                                                     CALIB_BARRIER_ITERS);
+
+  _cache.set(key, usec);
+
+  return usec;
+}
+
+ParallelPlan ParallelPlanner::plan(const PartitionedMSA& msa, size_t num_jobs)
+{
+  /* CLV work units and memory footprint for a single tree search */
+  const size_t num_tips = msa.full_msa().size();
+  double work_units = 0.;
+  unsigned long clv_mem = 0;
+  for (const auto& pinfo: msa.part_list())
+  {
+    const auto& model = pinfo.model();
+    const double states = model.num_states();
+    const double patterns = pinfo.msa().num_patterns();
+    const double ratecats = model.num_ratecats();
+
+    work_units += patterns * states * states * ratecats;
+    clv_mem += (unsigned long) (patterns * states * ratecats * sizeof(double)) * 2 * num_tips;
+  }
+
+  const double work_usec = PLANNER_CLVS_PER_EVAL * work_units * clv_unit_nsec() / 1000.;
+
+  const unsigned long mem_limit = PLANNER_MEM_FRACTION * sysutil_get_memtotal();
+  const size_t max_groups_mem = max<size_t>(1, clv_mem > 0 ? mem_limit / clv_mem : _num_threads);
+  const size_t max_groups = max<size_t>(1, min(num_jobs, max_groups_mem));
+
+  _candidates.clear();
+
+  ParallelPlan best;
+  best.group_size = _num_threads;
+  best.makespan = -1.;
+  for (size_t group_size = _num_threads; group_size > 0; --group_size)
+  {
+    if (_num_threads % group_size != 0)
+      continue;
+
+    ParallelPlan plan;
+    plan.group_size = group_size;
+    plan.num_groups = _num_threads / group_size;
+    plan.mem_per_group = clv_mem;
+
+    if (plan.num_groups > max_groups)
+      continue;
+
+    plan.eval_usec = work_usec / group_size +
+        PLANNER_REDUCTIONS_PER_EVAL * reduce_usec(group_size);
+    const size_t rounds = (max<size_t>(num_jobs, 1) + plan.num_groups - 1) / plan.num_groups;
+    plan.makespan = rounds * plan.eval_usec;
+
+    _candidates.push_back(plan);
+
+    /* candidates are sorted by decreasing group size: only switch to more groups
+     * if the estimated gain is significant */
+    if (best.makespan < 0. || plan.makespan < (1. - PLANNER_MIN_GAIN) * best.makespan)
+      best = plan;
+  }
+
+  return best;
+}
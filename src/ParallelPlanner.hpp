@@ -0,0 +1,58 @@
+#ifndef RAXML_PARALLELPLANNER_HPP_
+#define RAXML_PARALLELPLANNER_HPP_
+
+#include "common.h"
+#include "PartitionedMSA.hpp"
+#include "CalibrationCache.hpp"
+
+class Options;
+
+struct ParallelPlan
+{
+  ParallelPlan() : num_groups(1), group_size(1), eval_usec(0.), makespan(0.),
+      mem_per_group(0) {}
+
+  size_t num_groups;          /* number of worker groups (concurrent tree searches) */
+  size_t group_size;          /* threads per group */
+  double eval_usec;           /* estimated time for one (partial) likelihood evaluation */
+  double makespan;            /* estimated relative runtime: #rounds x eval_usec */
+  unsigned long mem_per_group;  /* estimated memory footprint of one tree search */
+};
+
+/*
+ * Chooses the number of worker groups and threads per group based on a simple cost model:
+ *
+ *   eval(s) = work / s + sync(s),  makespan(s) = ceil(jobs / (T / s)) * eval(s)
+ *
+ * where work is the CLV update cost for the alignment at hand (patterns x states^2 x rate
+ * categories, scaled by a calibrated per-unit kernel time), and sync(s) the calibrated cost
+ * of the reductions for a group of s threads. Number of groups is limited by available RAM.
+ */
+class ParallelPlanner
+{
+public:
+  ParallelPlanner(const Options& opts, CalibrationCache& cache);
+
+  ParallelPlan plan(const PartitionedMSA& msa, size_t num_jobs);
+
+  const std::vector<ParallelPlan>& candidates() const { return _candidates; }
+
+  /* cost of one CLV entry update per (state x state x rate category), in nanoseconds */
+  double clv_unit_nsec();
+
+  /* cost of one thread reduction within a group of the given size, in microseconds */
+  double reduce_usec(size_t group_size);
+
+  /* heterogeneous cores: relative speed (average 1.0) of threads pinned to the given CPUs,
+   * measured with the CLV kernel running on all of them at once. Empty if all threads
+   * are about equally fast */
+  doubleVector thread_speeds(const std::vector<int>& thread_cpus);
+
+private:
+  size_t _num_threads;
+  BarrierMode _barrier_mode;
+  CalibrationCache& _cache;
+  std::vector<ParallelPlan> _candidates;
+};
+
+#endif /* RAXML_PARALLELPLANNER_HPP_ */
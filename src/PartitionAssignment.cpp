@@ -26,7 +26,9 @@ std::ostream& operator<<(std::ostream& stream, const PartitionAssignmentList& pa
 std::ostream& operator<<(std::ostream& stream, const PartitionAssignmentStats& stats)
 {
   stream << "partitions/thread: " << stats.min_thread_parts << "-" << stats.max_thread_parts <<
-      ", patterns/thread: " << stats.min_thread_sites << "-" << stats.max_thread_sites;
+      ", patterns/thread: " << stats.min_thread_sites << "-" << stats.max_thread_sites <<
+      ", est. cost/thread: " << (size_t) stats.min_thread_cost << "-" <<
+      (size_t) stats.max_thread_cost;
   return stream;
 }
 
@@ -8,15 +8,17 @@
 
 struct PartitionRange
 {
-  PartitionRange() : part_id(0), start(0), length(0) {}
-  PartitionRange(size_t part_id, size_t start, size_t length):
-    part_id(part_id), start(start), length(length) {};
+  PartitionRange() : part_id(0), start(0), length(0), site_cost(1.) {}
+  PartitionRange(size_t part_id, size_t start, size_t length, double site_cost = 1.):
+    part_id(part_id), start(start), length(length), site_cost(site_cost) {};
 
   bool master() const { return start == 0; };
+  double cost() const { return length * site_cost; };
 
   size_t part_id;
   size_t start;
   size_t length;
+  double site_cost;     /* estimated relative cost per site, see PartitionInfo::site_cost() */
 };
 
 struct PartitionAssignment
@@ -25,10 +27,11 @@ struct PartitionAssignment
   typedef typename container::iterator        iterator;
   typedef typename container::const_iterator  const_iterator;
 
-  PartitionAssignment() : _weight(0.0) {}
+  PartitionAssignment() : _weight(0.0), _cost(0.0) {}
 
   size_t num_parts() const { return _part_range_list.size(); }
   size_t weight() const { return (size_t) _weight; }
+  double cost() const { return _cost; }
   const PartitionRange& operator[](size_t i) const { return _part_range_list.at(i); }
   const_iterator find(size_t part_id) const
   {
@@ -36,10 +39,11 @@ struct PartitionAssignment
                          [part_id](const PartitionRange& r) { return (r.part_id == part_id);} );
   };
 
-  void assign_sites(size_t partition_id, size_t offset, size_t length)
+  void assign_sites(size_t partition_id, size_t offset, size_t length, double site_cost = 1.)
   {
-    _part_range_list.emplace_back(partition_id, offset, length);
+    _part_range_list.emplace_back(partition_id, offset, length, site_cost);
     _weight += length;
+    _cost += length * site_cost;
   }
 
   const_iterator begin() const { return _part_range_list.cbegin(); };
@@ -48,6 +52,7 @@ struct PartitionAssignment
 private:
   container _part_range_list;
   double _weight;
+  double _cost;
 };
 
 typedef std::vector<PartitionAssignment> PartitionAssignmentList;
@@ -58,8 +63,14 @@ struct PartitionAssignmentStats
   {
     max_thread_sites = max_thread_parts = 0;
     min_thread_sites = min_thread_parts = std::numeric_limits<size_t>::max();
-    for (auto pa: part_assign)
+    min_thread_cost = std::numeric_limits<double>::max();
+    max_thread_cost = total_cost = 0.;
+    num_threads = part_assign.size();
+    for (auto const& pa: part_assign)
     {
+      min_thread_cost = std::min(min_thread_cost, pa.cost());
+      max_thread_cost = std::max(max_thread_cost, pa.cost());
+      total_cost += pa.cost();
       min_thread_sites = std::min(min_thread_sites, pa.weight());
       min_thread_parts = std::min(min_thread_parts, pa.num_parts());
       max_thread_sites = std::max(max_thread_sites, pa.weight());
@@ -71,6 +82,16 @@ struct PartitionAssignmentStats
   size_t min_thread_parts;
   size_t max_thread_sites;
   size_t max_thread_parts;
+  double min_thread_cost;
+  double max_thread_cost;
+  double total_cost;
+  size_t num_threads;
+
+  /* estimated slowdown due to load imbalance: max. cost vs. average cost per thread */
+  double imbalance() const
+  {
+    return total_cost > 0. ? max_thread_cost * num_threads / total_cost : 1.;
+  }
 };
 
 std::ostream& operator<<(std::ostream& stream, const PartitionAssignment& pa);
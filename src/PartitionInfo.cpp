@@ -126,3 +126,37 @@ void PartitionInfo::set_modeL_empirical_params()
 
   assign(_model, stats());
 }
+
+double PartitionInfo::site_cost(const Options& opts) const
+{
+  /* number of doubles per SIMD vector: libpll pads the state dimension to a multiple of it */
+  unsigned int simd_width;
+  switch (opts.simd_arch)
+  {
+    case PLL_ATTRIB_ARCH_SSE:
+      simd_width = 2;
+      break;
+    case PLL_ATTRIB_ARCH_AVX:
+    case PLL_ATTRIB_ARCH_AVX2:
+      simd_width = 4;
+      break;
+    default:
+      simd_width = 1;
+  }
+
+  const double states = _model.num_states();
+  const double states_padded = (_model.num_states() + simd_width - 1) / simd_width * simd_width;
+
+  /* mixture models: every rate category has its own substitution matrix */
+  const double ratecats = std::max(_model.num_ratecats(), _model.num_submodels());
+
+  /* CLV update: (states x padded states) matrix-vector product per rate category */
+  double cost = states * states_padded / simd_width * ratecats;
+
+  /* tip-inner: CLVs of the tip children (about half of all operands) come from precomputed
+   * lookup tables (see create_pll_partition()) */
+  if (opts.use_tip_inner && (unsigned long) _msa.length() > RAXML_TIP_INNER_MIN_LENGTH)
+    cost *= 0.6;
+
+  return cost;
+}
@@ -39,6 +39,10 @@ public:
   const pllmod_msa_stats_t * stats() const;
   pllmod_msa_stats_t * compute_stats(unsigned long stats_mask) const;
 
+  /* estimated relative cost of one alignment site (pattern) in likelihood computations,
+   * depends on model and kernel settings: used to balance the load among threads */
+  double site_cost(const Options& opts) const;
+
   // setters
   void msa(MSA&& msa) { _msa = std::move(msa); };
   void model(Model&& model) { _model = std::move(model); };
@@ -0,0 +1,93 @@
+#include <algorithm>
+
+#include "SprCandidateSearch.hpp"
+
+using namespace std;
+
+std::vector<std::unique_ptr<SprCandidateSearch>> SprCandidateSearch::_groups;
+
+bool spr_move_better(const SprMove& a, const SprMove& b)
+{
+  if (a.loglh != b.loglh)
+    return a.loglh > b.loglh;
+  else if (a.prune_index != b.prune_index)
+    return a.prune_index < b.prune_index;
+  else
+    return a.regraft_index < b.regraft_index;
+}
+
+static void hash_topology(const pll_unode_t * node, int radius, uint64_t& hash)
+{
+  /* NB: the branching is implied by node indices, so no separators are needed */
+  hash = (hash ^ node->node_index) * 1099511628211ULL;
+
+  if (radius > 0 && node->next)
+  {
+    hash_topology(node->next->back, radius - 1, hash);
+    hash_topology(node->next->next->back, radius - 1, hash);
+  }
+}
+
+uint64_t spr_topology_hash(const pll_unode_t * p, int radius)
+{
+  uint64_t hash = 14695981039346656037ULL;
+  for (auto node: {p->back, p->next->back, p->next->next->back})
+    hash_topology(node, radius, hash);
+
+  return hash;
+}
+
+void SprMoveList::reset(size_t max_size)
+{
+  _moves.clear();
+  _moves.reserve(max_size);
+  _max_size = max_size;
+}
+
+void SprMoveList::insert(const SprMove& move)
+{
+  lock_guard<mutex> lock(_mutex);
+
+  if (_moves.size() < _max_size)
+  {
+    _moves.push_back(move);
+    push_heap(_moves.begin(), _moves.end(), spr_move_better);
+  }
+  else if (_max_size > 0 && spr_move_better(move, _moves.front()))
+  {
+    pop_heap(_moves.begin(), _moves.end(), spr_move_better);
+    _moves.back() = move;
+    push_heap(_moves.begin(), _moves.end(), spr_move_better);
+  }
+}
+
+std::vector<SprMove> SprMoveList::sorted() const
+{
+  auto result = _moves;
+  sort(result.begin(), result.end(), spr_move_better);
+  return result;
+}
+
+void SprCandidateSearch::reset(size_t max_moves, size_t num_nodes, bool clear_memo)
+{
+  _best_moves.reset(max_moves);
+  _next_prune = 0;
+
+  if (clear_memo || _memo.size() != num_nodes)
+  {
+    _memo.assign(num_nodes, SprMemoEntry());
+    _memo_valid.assign(num_nodes, 0);
+  }
+}
+
+void SprCandidateSearch::init_groups(size_t num_groups)
+{
+  _groups.clear();
+  for (size_t i = 0; i < num_groups; ++i)
+    _groups.emplace_back(new SprCandidateSearch());
+}
+
+SprCandidateSearch * SprCandidateSearch::group(size_t group_id)
+{
+  return _groups.empty() ? nullptr : _groups.at(group_id).get();
+}
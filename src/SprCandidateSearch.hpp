@@ -0,0 +1,111 @@
+#ifndef RAXML_SPRCANDIDATESEARCH_HPP_
+#define RAXML_SPRCANDIDATESEARCH_HPP_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+#include "common.h"
+
+/* SPR move: prune the subtree behind prune_node->back and re-insert it into the branch
+ * (regraft_node, regraft_node->back). Nodes are identified by node_index, which is the same
+ * in all copies of a tree. */
+struct SprMove
+{
+  double loglh;
+  unsigned int prune_index;
+  unsigned int regraft_index;
+};
+
+/* higher logLH first; ties are broken by node indices, such that all threads agree */
+bool spr_move_better(const SprMove& a, const SprMove& b);
+
+/* prune node for which no improving move was found: the record stays valid as long as the
+ * topology within the search radius (and the radius window itself) remains the same */
+struct SprMemoEntry
+{
+  uint64_t topology_hash;
+  int radius_min;
+  int radius_max;
+  bool thorough;
+
+  bool operator==(const SprMemoEntry& other) const
+  {
+    return topology_hash == other.topology_hash && radius_min == other.radius_min &&
+        radius_max == other.radius_max && thorough == other.thorough;
+  }
+};
+
+/* hash of the topology around prune node p within the given radius (FNV-1a over node indices),
+ * i.e. changes whenever a move changes the neighborhood covered by a memo record */
+uint64_t spr_topology_hash(const pll_unode_t * p, int radius);
+
+/* the (at most) k best moves found by all threads of a group, thread-safe */
+class SprMoveList
+{
+public:
+  SprMoveList() : _max_size(0) {}
+
+  /* NB: not thread-safe, must not be called concurrently with insert() */
+  void reset(size_t max_size);
+
+  void insert(const SprMove& move);
+
+  /* best move first (NB: call only after all insert() calls are done) */
+  std::vector<SprMove> sorted() const;
+
+private:
+  std::mutex _mutex;
+  std::vector<SprMove> _moves;    /* heap with the worst move on top */
+  size_t _max_size;
+};
+
+/*
+ * Candidate-parallel SPR rounds: every thread of a worker group holds the whole alignment and
+ * its own copy of the tree. Threads evaluate the regraft positions of disjoint sets of prune
+ * nodes and collect the best moves in a shared list; then every thread applies the same moves
+ * in the same order to its own tree, so that all copies stay identical.
+ */
+class SprCandidateSearch
+{
+public:
+  SprCandidateSearch() : _next_prune(0) {}
+
+  SprCandidateSearch(const SprCandidateSearch& other) = delete;
+  SprCandidateSearch& operator=(const SprCandidateSearch& other) = delete;
+
+  SprMoveList& best_moves() { return _best_moves; }
+
+  /* start a new round (one thread, while the others are waiting at a barrier); the memo
+   * is discarded if clear_memo is set, e.g. for a new starting tree */
+  void reset(size_t max_moves, size_t num_nodes, bool clear_memo);
+
+  /* position of the next prune node to be evaluated by the calling thread */
+  size_t next_prune() { return _next_prune++; }
+
+  /* cross-round memo of prune nodes without improving moves, indexed by node_index
+   * (NB: every prune node is evaluated by exactly one thread per round) */
+  bool memo_hit(unsigned int prune_index, const SprMemoEntry& entry) const
+  { return _memo_valid[prune_index] && _memo[prune_index] == entry; }
+  void memo_store(unsigned int prune_index, const SprMemoEntry& entry)
+  { _memo[prune_index] = entry; _memo_valid[prune_index] = true; }
+  void memo_clear(unsigned int prune_index) { _memo_valid[prune_index] = false; }
+
+  /* create one instance per worker group (call from master thread before the
+   * workers start) */
+  static void init_groups(size_t num_groups);
+
+  /* instance of the given worker group, nullptr if not initialized */
+  static SprCandidateSearch * group(size_t group_id);
+
+private:
+  SprMoveList _best_moves;
+  std::atomic<size_t> _next_prune;
+  std::vector<SprMemoEntry> _memo;
+  std::vector<char> _memo_valid;
+
+  static std::vector<std::unique_ptr<SprCandidateSearch>> _groups;
+};
+
+#endif /* RAXML_SPRCANDIDATESEARCH_HPP_ */
@@ -0,0 +1,97 @@
+#include <thread>
+
+#include "ThreadBarrier.hpp"
+
+static inline void cpu_relax()
+{
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#endif
+}
+
+ThreadBarrier::ThreadBarrier(size_t num_threads, BarrierMode mode, size_t spin_count) :
+    _arrived(0), _sense(0), _sleepers(0)
+{
+  reset(num_threads, mode, spin_count);
+}
+
+void ThreadBarrier::reset(size_t num_threads, BarrierMode mode, size_t spin_count)
+{
+  _arrived.store(0);
+  _num_threads = num_threads;
+  _mode = mode;
+  _spin_count = spin_count;
+}
+
+void ThreadBarrier::wait()
+{
+  if (_num_threads < 2)
+    return;
+
+  /* sense of the current barrier episode: it can only change once all threads arrived */
+  const unsigned int sense = _sense.load(std::memory_order_acquire);
+
+  if (_arrived.fetch_add(1, std::memory_order_acq_rel) == _num_threads - 1)
+  {
+    /* last thread: reset counter *before* releasing the others */
+    _arrived.store(0, std::memory_order_relaxed);
+    release(sense);
+  }
+  else
+    wait_release(sense);
+}
+
+void ThreadBarrier::release(unsigned int sense)
+{
+  _sense.store(sense + 1, std::memory_order_seq_cst);
+
+  /* wake up sleeping threads, if any. Taking the mutex ensures that a thread which
+   * has already registered as a sleeper is either blocked in wait() or will see
+   * the new sense when checking the predicate */
+  if (_mode != BarrierMode::spin && _sleepers.load(std::memory_order_seq_cst) > 0)
+  {
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+    }
+    _cv.notify_all();
+  }
+}
+
+void ThreadBarrier::wait_release(unsigned int sense)
+{
+  if (_mode != BarrierMode::block)
+  {
+    for (size_t i = 0; _mode == BarrierMode::spin || i < _spin_count; ++i)
+    {
+      if (_sense.load(std::memory_order_acquire) != sense)
+        return;
+      cpu_relax();
+
+      /* give up time slice from time to time: the thread we are waiting for
+       * might be waiting for a core */
+      if (_mode == BarrierMode::adaptive && (i + 1) % RAXML_BARRIER_YIELD_INTERVAL == 0)
+        std::this_thread::yield();
+    }
+  }
+
+  std::unique_lock<std::mutex> lock(_mutex);
+  _sleepers.fetch_add(1, std::memory_order_seq_cst);
+  _cv.wait(lock, [this, sense]() -> bool
+           { return _sense.load(std::memory_order_seq_cst) != sense; });
+  _sleepers.fetch_sub(1, std::memory_order_relaxed);
+}
+
+std::string barrier_mode_name(BarrierMode mode)
+{
+  switch (mode)
+  {
+    case BarrierMode::spin:
+      return "spin";
+    case BarrierMode::adaptive:
+      return "adaptive";
+    case BarrierMode::block:
+      return "block";
+    default:
+      return "UNKNOWN";
+  }
+}
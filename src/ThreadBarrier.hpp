@@ -0,0 +1,67 @@
+#ifndef RAXML_THREADBARRIER_HPP_
+#define RAXML_THREADBARRIER_HPP_
+
+#include <string>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+
+#define RAXML_CACHE_LINE_SIZE     64
+
+/* number of busy-wait iterations before a waiting thread goes to sleep (adaptive mode) */
+#define RAXML_BARRIER_SPIN_COUNT  4096
+#define RAXML_BARRIER_YIELD_INTERVAL  256
+
+enum class BarrierMode
+{
+  spin,       /* pure busy-wait: lowest latency, burns cores while waiting */
+  adaptive,   /* bounded busy-wait, then block on condition variable */
+  block       /* always block on condition variable */
+};
+
+/*
+ * Reusable sense-reversal barrier: the last arriving thread resets the counter and flips
+ * the global sense, all other threads wait until the sense differs from the value they saw
+ * on arrival. Counter and sense live on separate cache lines to avoid false sharing
+ * between arriving and waiting threads.
+ */
+class ThreadBarrier
+{
+public:
+  ThreadBarrier(size_t num_threads = 1, BarrierMode mode = BarrierMode::adaptive,
+                size_t spin_count = RAXML_BARRIER_SPIN_COUNT);
+
+  ThreadBarrier(const ThreadBarrier& other) = delete;
+  ThreadBarrier& operator=(const ThreadBarrier& other) = delete;
+
+  size_t num_threads() const { return _num_threads; }
+  BarrierMode mode() const { return _mode; }
+
+  /* NOT thread-safe: must be called while no thread is waiting at the barrier */
+  void reset(size_t num_threads, BarrierMode mode,
+             size_t spin_count = RAXML_BARRIER_SPIN_COUNT);
+
+  void wait();
+
+private:
+  std::atomic<size_t> _arrived;
+  char _pad1[RAXML_CACHE_LINE_SIZE - sizeof(std::atomic<size_t>)];
+
+  std::atomic<unsigned int> _sense;
+  std::atomic<unsigned int> _sleepers;
+  char _pad2[RAXML_CACHE_LINE_SIZE - 2 * sizeof(std::atomic<unsigned int>)];
+
+  size_t _num_threads;
+  BarrierMode _mode;
+  size_t _spin_count;
+
+  std::mutex _mutex;
+  std::condition_variable _cv;
+
+  void release(unsigned int sense);
+  void wait_release(unsigned int sense);
+};
+
+std::string barrier_mode_name(BarrierMode mode);
+
+#endif /* RAXML_THREADBARRIER_HPP_ */
@@ -0,0 +1,348 @@
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <map>
+#include <set>
+#include <tuple>
+#include <cstdio>
+
+#include <dirent.h>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+#include "ThreadPinning.hpp"
+
+using namespace std;
+
+#define SYSFS_CPU_DIR   "/sys/devices/system/cpu"
+#define SYSFS_NODE_DIR  "/sys/devices/system/node"
+
+static int read_int_file(const string& fname, int default_value)
+{
+  ifstream fs(fname);
+  int value;
+  if (fs >> value)
+    return value;
+  else
+    return default_value;
+}
+
+/* parse CPU list in sysfs format, e.g. "0-3,8,10-11" */
+static vector<int> parse_cpu_list(const string& list)
+{
+  vector<int> cpus;
+  istringstream ss(list);
+  string range;
+  while (getline(ss, range, ','))
+  {
+    int first, last;
+    if (sscanf(range.c_str(), "%d-%d", &first, &last) == 2)
+    {
+      for (int i = first; i <= last; ++i)
+        cpus.push_back(i);
+    }
+    else if (sscanf(range.c_str(), "%d", &first) == 1)
+      cpus.push_back(first);
+  }
+  return cpus;
+}
+
+static vector<int> available_cpus()
+{
+  vector<int> cpus;
+
+#ifdef __linux__
+  cpu_set_t mask;
+  CPU_ZERO(&mask);
+  if (sched_getaffinity(0, sizeof(mask), &mask) == 0)
+  {
+    for (int i = 0; i < CPU_SETSIZE; ++i)
+    {
+      if (CPU_ISSET(i, &mask))
+        cpus.push_back(i);
+    }
+  }
+#endif
+
+  if (cpus.empty())
+  {
+    ifstream fs(SYSFS_CPU_DIR "/online");
+    string list;
+    if (fs >> list)
+      cpus = parse_cpu_list(list);
+  }
+
+  return cpus;
+}
+
+static map<int, int> cpu_node_map()
+{
+  map<int, int> node_map;
+
+  DIR * dir = opendir(SYSFS_NODE_DIR);
+  if (!dir)
+    return node_map;
+
+  struct dirent * entry;
+  while ((entry = readdir(dir)) != NULL)
+  {
+    int node_id;
+    if (sscanf(entry->d_name, "node%d", &node_id) != 1)
+      continue;
+
+    ifstream fs(string(SYSFS_NODE_DIR) + "/" + entry->d_name + "/cpulist");
+    string list;
+    if (fs >> list)
+    {
+      for (auto cpu: parse_cpu_list(list))
+        node_map[cpu] = node_id;
+    }
+  }
+  closedir(dir);
+
+  return node_map;
+}
+
+CpuTopology::CpuTopology()
+{
+  auto node_map = cpu_node_map();
+
+  for (auto id: available_cpus())
+  {
+    const string topo_dir = string(SYSFS_CPU_DIR) + "/cpu" + to_string(id) + "/topology/";
+
+    LogicalCpu cpu;
+    cpu.id = id;
+    cpu.core_id = read_int_file(topo_dir + "core_id", id);
+    cpu.socket_id = read_int_file(topo_dir + "physical_package_id", 0);
+    cpu.node_id = node_map.count(id) ? node_map.at(id) : cpu.socket_id;
+    cpu.smt_id = 0;
+    _cpus.push_back(cpu);
+  }
+
+  /* number hardware threads within each physical core */
+  map<pair<int,int>, int> smt_count;
+  for (auto& cpu: _cpus)
+    cpu.smt_id = smt_count[make_pair(cpu.socket_id, cpu.core_id)]++;
+}
+
+size_t CpuTopology::num_cores() const
+{
+  set<pair<int,int>> cores;
+  for (const auto& cpu: _cpus)
+    cores.insert(make_pair(cpu.socket_id, cpu.core_id));
+  return cores.size();
+}
+
+size_t CpuTopology::num_sockets() const
+{
+  set<int> sockets;
+  for (const auto& cpu: _cpus)
+    sockets.insert(cpu.socket_id);
+  return sockets.size();
+}
+
+size_t CpuTopology::num_nodes() const
+{
+  set<int> nodes;
+  for (const auto& cpu: _cpus)
+    nodes.insert(cpu.node_id);
+  return nodes.size();
+}
+
+const LogicalCpu& CpuTopology::cpu(int id) const
+{
+  for (const auto& cpu: _cpus)
+  {
+    if (cpu.id == id)
+      return cpu;
+  }
+  throw out_of_range("CPU not found: " + to_string(id));
+}
+
+/* all physical cores first, hyperthreads last; within SMT level: by node, socket, core */
+static bool compact_order(const LogicalCpu& a, const LogicalCpu& b)
+{
+  return make_tuple(a.smt_id, a.node_id, a.socket_id, a.core_id, a.id) <
+         make_tuple(b.smt_id, b.node_id, b.socket_id, b.core_id, b.id);
+}
+
+static vector<int> scatter_order(const vector<LogicalCpu>& cpus)
+{
+  /* take one core from each socket in turn */
+  map<pair<int,int>, vector<LogicalCpu>> socket_cpus;
+  for (const auto& cpu: cpus)
+    socket_cpus[make_pair(cpu.smt_id, cpu.socket_id)].push_back(cpu);
+
+  vector<int> order;
+  auto it = socket_cpus.begin();
+  while (it != socket_cpus.end())
+  {
+    /* all sockets with the same SMT level */
+    auto level_end = it;
+    while (level_end != socket_cpus.end() && level_end->first.first == it->first.first)
+      ++level_end;
+
+    for (size_t i = 0; ; ++i)
+    {
+      bool added = false;
+      for (auto s = it; s != level_end; ++s)
+      {
+        if (i < s->second.size())
+        {
+          order.push_back(s->second[i].id);
+          added = true;
+        }
+      }
+      if (!added)
+        break;
+    }
+    it = level_end;
+  }
+
+  return order;
+}
+
+/* contiguous block of physical cores (by node, socket, core) with all their hardware threads */
+static vector<LogicalCpu> node_rank_share(const vector<LogicalCpu>& cpus, size_t node_rank,
+                                          size_t node_ranks)
+{
+  typedef tuple<int,int,int> CoreId;
+  vector<CoreId> cores;
+  for (const auto& cpu: cpus)
+    cores.emplace_back(cpu.node_id, cpu.socket_id, cpu.core_id);
+  sort(cores.begin(), cores.end());
+  cores.erase(unique(cores.begin(), cores.end()), cores.end());
+
+  /* NB: with more ranks than cores, ranks have to share cores */
+  const size_t num_cores = cores.size();
+  size_t first = node_rank % num_cores;
+  size_t last = first + 1;
+  if (node_ranks <= num_cores)
+  {
+    first = node_rank * num_cores / node_ranks;
+    last = (node_rank + 1) * num_cores / node_ranks;
+  }
+
+  set<CoreId> share(cores.begin() + first, cores.begin() + last);
+  vector<LogicalCpu> result;
+  for (const auto& cpu: cpus)
+  {
+    if (share.count(make_tuple(cpu.node_id, cpu.socket_id, cpu.core_id)))
+      result.push_back(cpu);
+  }
+
+  return result;
+}
+
+std::vector<int> compute_thread_cpus(const CpuTopology& topo, PinMode mode,
+                                     size_t num_threads, size_t num_groups,
+                                     size_t node_rank, size_t node_ranks)
+{
+  vector<int> thread_cpus;
+
+  if (mode == PinMode::none || topo.num_cpus() == 0)
+    return thread_cpus;
+
+  auto cpus = node_ranks > 1 ? node_rank_share(topo.cpus(), node_rank, node_ranks) :
+                               topo.cpus();
+  sort(cpus.begin(), cpus.end(), compact_order);
+
+  if (mode == PinMode::compact || mode == PinMode::scatter)
+  {
+    vector<int> order;
+    if (mode == PinMode::compact)
+    {
+      for (const auto& cpu: cpus)
+        order.push_back(cpu.id);
+    }
+    else
+      order = scatter_order(cpus);
+
+    /* NB: wrap around if there are more threads than CPUs */
+    for (size_t i = 0; i < num_threads; ++i)
+      thread_cpus.push_back(order[i % order.size()]);
+  }
+  else if (mode == PinMode::numa)
+  {
+    /* CPUs of every NUMA node in compact order */
+    map<int, vector<int>> node_cpus;
+    for (const auto& cpu: cpus)
+      node_cpus[cpu.node_id].push_back(cpu.id);
+
+    vector<vector<int>> nodes;
+    for (auto& n: node_cpus)
+      nodes.push_back(n.second);
+
+    const size_t num_nodes = nodes.size();
+    const size_t group_size = num_threads / max<size_t>(num_groups, 1);
+    vector<size_t> next_cpu(num_nodes, 0);
+    for (size_t i = 0; i < num_threads; ++i)
+    {
+      /* if there are enough groups, place every group on a single node; otherwise,
+       * split groups into contiguous blocks spread evenly across nodes */
+      const size_t node = (num_groups >= num_nodes) ?
+          (i / group_size) * num_nodes / num_groups : i * num_nodes / num_threads;
+      const auto& ncpus = nodes[node];
+      thread_cpus.push_back(ncpus[next_cpu[node]++ % ncpus.size()]);
+    }
+  }
+
+  return thread_cpus;
+}
+
+bool pin_current_thread(int cpu_id)
+{
+#ifdef __linux__
+  cpu_set_t mask;
+  CPU_ZERO(&mask);
+  CPU_SET(cpu_id, &mask);
+
+  /* NB: on Linux, pid=0 refers to the calling thread */
+  return sched_setaffinity(0, sizeof(mask), &mask) == 0;
+#else
+  (void) cpu_id;
+  return false;
+#endif
+}
+
+std::string pin_mode_name(PinMode mode)
+{
+  switch (mode)
+  {
+    case PinMode::none:
+      return "none";
+    case PinMode::compact:
+      return "compact";
+    case PinMode::scatter:
+      return "scatter";
+    case PinMode::numa:
+      return "numa";
+    default:
+      return "UNKNOWN";
+  }
+}
+
+std::string thread_layout_str(const CpuTopology& topo, const std::vector<int>& thread_cpus)
+{
+  ostringstream ss;
+
+  ss << topo.num_cpus() << " CPUs, " << topo.num_cores() << " cores, " <<
+      topo.num_sockets() << " socket(s), " << topo.num_nodes() << " NUMA node(s)";
+
+  /* threads per node */
+  map<int, vector<size_t>> node_threads;
+  for (size_t i = 0; i < thread_cpus.size(); ++i)
+    node_threads[topo.cpu(thread_cpus[i]).node_id].push_back(i);
+
+  for (const auto& n: node_threads)
+  {
+    ss << "\n    node " << n.first << ": thread -> cpu";
+    for (auto t: n.second)
+      ss << " " << t << "->" << thread_cpus[t];
+  }
+
+  return ss.str();
+}
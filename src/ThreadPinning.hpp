@@ -0,0 +1,59 @@
+#ifndef RAXML_THREADPINNING_HPP_
+#define RAXML_THREADPINNING_HPP_
+
+#include <string>
+#include <vector>
+
+enum class PinMode
+{
+  none,       /* no pinning, let the OS scheduler decide */
+  compact,    /* fill physical cores socket by socket, then hyperthreads */
+  scatter,    /* distribute threads round-robin across sockets */
+  numa        /* spread threads evenly across NUMA nodes, keep worker groups within a node */
+};
+
+struct LogicalCpu
+{
+  int id;
+  int core_id;
+  int socket_id;
+  int node_id;
+  int smt_id;     /* index of this hardware thread within its physical core */
+};
+
+/* CPU topology as seen by the current process (i.e., only CPUs in its affinity mask),
+ * parsed from /sys/devices/system */
+class CpuTopology
+{
+public:
+  /* CPUs available to this process */
+  CpuTopology();
+  /* given list of CPUs, e.g. for testing */
+  explicit CpuTopology(const std::vector<LogicalCpu>& cpus) : _cpus(cpus) {}
+
+  const std::vector<LogicalCpu>& cpus() const { return _cpus; }
+  size_t num_cpus() const { return _cpus.size(); }
+  size_t num_cores() const;
+  size_t num_sockets() const;
+  size_t num_nodes() const;
+
+  const LogicalCpu& cpu(int id) const;
+
+private:
+  std::vector<LogicalCpu> _cpus;
+};
+
+/* returns CPU id for every thread, or empty vector if pinning is disabled; if the CPUs of topo
+ * are shared by node_ranks processes (e.g. MPI ranks on the same node, not bound to disjoint
+ * CPU sets by the launcher), only the node_rank-th share of the physical cores is used */
+std::vector<int> compute_thread_cpus(const CpuTopology& topo, PinMode mode,
+                                     size_t num_threads, size_t num_groups,
+                                     size_t node_rank = 0, size_t node_ranks = 1);
+
+/* pin calling thread to the given CPU */
+bool pin_current_thread(int cpu_id);
+
+std::string pin_mode_name(PinMode mode);
+std::string thread_layout_str(const CpuTopology& topo, const std::vector<int>& thread_cpus);
+
+#endif /* RAXML_THREADPINNING_HPP_ */
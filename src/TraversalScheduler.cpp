@@ -0,0 +1,170 @@
+#include "TraversalScheduler.hpp"
+
+using namespace std;
+
+std::vector<std::unique_ptr<TraversalScheduler>> TraversalScheduler::_teams;
+size_t TraversalScheduler::_team_threads = 1;
+
+void TraversalDAG::build(const pll_operation_t * ops, size_t ops_count)
+{
+  _parent.assign(ops_count, -1);
+  _num_deps.assign(ops_count, 0);
+  _ready.clear();
+
+  unsigned int max_clv_index = 0;
+  for (size_t i = 0; i < ops_count; ++i)
+  {
+    max_clv_index = max(max_clv_index, ops[i].parent_clv_index);
+    max_clv_index = max(max_clv_index, ops[i].child1_clv_index);
+    max_clv_index = max(max_clv_index, ops[i].child2_clv_index);
+  }
+  _producer.assign(max_clv_index + 1, -1);
+
+  for (size_t i = 0; i < ops_count; ++i)
+  {
+    const auto& op = ops[i];
+
+    /* NB: in a post-order list, child CLVs are always computed before their parent */
+    for (auto child: {op.child1_clv_index, op.child2_clv_index})
+    {
+      const int prod = _producer[child];
+      if (prod >= 0)
+      {
+        assert(_parent[prod] < 0);
+        _parent[prod] = (int) i;
+        _num_deps[i]++;
+      }
+    }
+
+    if (!_num_deps[i])
+      _ready.push_back(i);
+
+    assert(_producer[op.parent_clv_index] < 0);
+    _producer[op.parent_clv_index] = (int) i;
+  }
+}
+
+TraversalScheduler::TraversalScheduler(size_t team_size, BarrierMode barrier_mode) :
+    _team_size(team_size), _barrier(team_size, barrier_mode), _ops(nullptr), _pending_size(0)
+{
+  for (size_t i = 0; i < team_size; ++i)
+    _queues.emplace_back(new WorkQueue());
+}
+
+void TraversalScheduler::prepare(const pll_operation_t * ops, size_t ops_count,
+                                 const std::vector<pll_partition_t*>& partitions)
+{
+  /* NB: other team members are waiting at the barrier in execute(), so no locking needed */
+  _ops = ops;
+  _partitions = partitions;
+  _dag.build(ops, ops_count);
+
+  if (ops_count > _pending_size)
+  {
+    _pending.reset(new std::atomic<unsigned int>[ops_count]);
+    _pending_size = ops_count;
+  }
+
+  for (size_t i = 0; i < ops_count; ++i)
+    _pending[i].store(_dag.num_deps(i), std::memory_order_relaxed);
+
+  /* initial tasks are assigned in contiguous blocks: neighbours in the post-order list
+   * are likely to belong to the same subtree */
+  const auto& ready = _dag.ready();
+  for (size_t m = 0; m < _team_size; ++m)
+  {
+    auto& tasks = _queues[m]->tasks;
+    tasks.clear();
+    tasks.insert(tasks.end(), ready.begin() + m * ready.size() / _team_size,
+                 ready.begin() + (m + 1) * ready.size() / _team_size);
+  }
+}
+
+bool TraversalScheduler::next_task(size_t member_id, unsigned int& op)
+{
+  /* own queue: take the most recently added task */
+  {
+    auto& queue = *_queues[member_id];
+    std::lock_guard<std::mutex> lock(queue.mtx);
+    if (!queue.tasks.empty())
+    {
+      op = queue.tasks.back();
+      queue.tasks.pop_back();
+      return true;
+    }
+  }
+
+  /* steal the oldest task of another team member */
+  for (size_t i = 1; i < _team_size; ++i)
+  {
+    auto& queue = *_queues[(member_id + i) % _team_size];
+    std::lock_guard<std::mutex> lock(queue.mtx);
+    if (!queue.tasks.empty())
+    {
+      op = queue.tasks.front();
+      queue.tasks.pop_front();
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void TraversalScheduler::run_task(unsigned int op)
+{
+  for (auto partition: _partitions)
+    pll_update_partials(partition, _ops + op, 1);
+}
+
+void TraversalScheduler::execute(size_t member_id)
+{
+  /* wait until the leader has prepared the traversal */
+  _barrier.wait();
+
+  unsigned int op;
+  while (next_task(member_id, op))
+  {
+    /* the thread which completes the last dependency continues with the parent operation */
+    for (;;)
+    {
+      run_task(op);
+
+      const int parent = _dag.parent(op);
+      if (parent < 0 || _pending[parent].fetch_sub(1, std::memory_order_acq_rel) != 1)
+        break;
+
+      op = (unsigned int) parent;
+    }
+  }
+
+  /* NB: queues are only filled in prepare(), so once they are empty, the remaining operations
+   * are executed by the threads completing their dependencies. Idle threads wait here (using
+   * the --barrier policy) until all operations are done, and nobody accesses the task graph
+   * before the next traversal is prepared */
+  _barrier.wait();
+}
+
+void TraversalScheduler::init_teams(size_t num_threads, size_t team_size,
+                                    BarrierMode barrier_mode)
+{
+  _teams.clear();
+  _team_threads = max<size_t>(team_size, 1);
+
+  if (team_size < 2)
+    return;
+
+  assert(num_threads % team_size == 0);
+
+  for (size_t i = 0; i < num_threads / team_size; ++i)
+    _teams.emplace_back(new TraversalScheduler(team_size, barrier_mode));
+}
+
+TraversalScheduler * TraversalScheduler::team(size_t thread_id)
+{
+  return _teams.empty() ? nullptr : _teams.at(thread_id / _team_threads).get();
+}
+
+size_t TraversalScheduler::team_member(size_t thread_id)
+{
+  return thread_id % _team_threads;
+}
@@ -0,0 +1,95 @@
+#ifndef RAXML_TRAVERSALSCHEDULER_HPP_
+#define RAXML_TRAVERSALSCHEDULER_HPP_
+
+#include <deque>
+#include <memory>
+
+#include "common.h"
+
+/*
+ * Dependency graph of a post-order CLV traversal: an operation can be executed as soon as
+ * the operations computing its child CLVs are done. Operations for independent subtrees
+ * have no path between them and can thus run concurrently.
+ */
+class TraversalDAG
+{
+public:
+  TraversalDAG() {}
+
+  /* NB: assumes that every CLV is computed at most once, as in a pll_utree_traverse() list */
+  void build(const pll_operation_t * ops, size_t ops_count);
+
+  size_t size() const { return _parent.size(); }
+
+  /* operation which consumes the result of op (-1 for the last one) */
+  int parent(size_t op) const { return _parent[op]; }
+
+  /* number of operations op depends on (0, 1 or 2) */
+  unsigned int num_deps(size_t op) const { return _num_deps[op]; }
+
+  /* operations with no dependencies (children are tips or valid CLVs), in traversal order */
+  const std::vector<unsigned int>& ready() const { return _ready; }
+
+private:
+  std::vector<int> _parent;
+  std::vector<unsigned int> _num_deps;
+  std::vector<unsigned int> _ready;
+  std::vector<int> _producer;     /* CLV index -> operation computing it */
+};
+
+/*
+ * Task-parallel CLV updates: threads of a team share the partitions of the team leader and
+ * execute the operations of a traversal as soon as their dependencies are met. Every thread
+ * starts with a block of operations without dependencies; the thread which completes the last
+ * dependency of an operation executes it right away (depth-first, good locality). Idle threads
+ * steal from the other end of the other threads' queues.
+ */
+class TraversalScheduler
+{
+public:
+  TraversalScheduler(size_t team_size, BarrierMode barrier_mode);
+
+  TraversalScheduler(const TraversalScheduler& other) = delete;
+  TraversalScheduler& operator=(const TraversalScheduler& other) = delete;
+
+  size_t team_size() const { return _team_size; }
+
+  /* team leader: set traversal to be computed for the given partitions */
+  void prepare(const pll_operation_t * ops, size_t ops_count,
+               const std::vector<pll_partition_t*>& partitions);
+
+  /* all team members: compute all CLVs of the prepared traversal, returns once they are done */
+  void execute(size_t member_id);
+
+  /* create teams of team_size consecutive threads (call from master thread before
+   * the workers start); team_size = 1 disables task-parallel CLV updates */
+  static void init_teams(size_t num_threads, size_t team_size, BarrierMode barrier_mode);
+
+  /* team of the given thread, nullptr if not initialized */
+  static TraversalScheduler * team(size_t thread_id);
+  static size_t team_member(size_t thread_id);
+
+private:
+  struct WorkQueue
+  {
+    std::mutex mtx;
+    std::deque<unsigned int> tasks;
+  };
+
+  size_t _team_size;
+  ThreadBarrier _barrier;
+  const pll_operation_t * _ops;
+  std::vector<pll_partition_t*> _partitions;
+  TraversalDAG _dag;
+  std::unique_ptr<std::atomic<unsigned int>[]> _pending;
+  size_t _pending_size;
+  std::vector<std::unique_ptr<WorkQueue>> _queues;
+
+  static std::vector<std::unique_ptr<TraversalScheduler>> _teams;
+  static size_t _team_threads;
+
+  bool next_task(size_t member_id, unsigned int& op);
+  void run_task(unsigned int op);
+};
+
+#endif /* RAXML_TRAVERSALSCHEDULER_HPP_ */
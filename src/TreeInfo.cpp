@@ -1,10 +1,21 @@
 #include <algorithm>
+#include <cmath>
+#include <limits>
+#include <list>
 
 #include "TreeInfo.hpp"
 #include "ParallelContext.hpp"
+#include "SprCandidateSearch.hpp"
+#include "TraversalScheduler.hpp"
 
 using namespace std;
 
+/* candidate-parallel SPR rounds: minimum number of moves to be re-evaluated at the end of a
+ * round (ntopol_keep is 0 during radius detection, and a single move per round is too few) */
+#define SPR_CANDIDATES_MIN_MOVES 64
+
+std::atomic<unsigned long long> TreeInfo::_skipped_clv_updates(0);
+
 TreeInfo::TreeInfo (const Options &opts, const Tree& tree, const PartitionedMSA& parted_msa,
                     const PartitionAssignment& part_assign)
 {
@@ -28,12 +39,28 @@ void TreeInfo::init(const Options &opts, const Tree& tree, const PartitionedMSA&
   if (!_pll_treeinfo)
     throw runtime_error("ERROR creating treeinfo structure: " + string(pll_errmsg));
 
-  if (ParallelContext::num_procs() > 1)
+  _loglh = 0.;
+  _loglh_valid = false;
+  _clvs_valid = false;
+  _modopt = ModelOptScheduler(opts.adaptive_modopt);
+
+  /* NB: candidate-parallel SPR rounds: every thread holds the whole alignment (see
+   * balance_load()), so there is nothing to reduce */
+  _spr_search = opts.spr_mode == SprMode::candidates ?
+      SprCandidateSearch::group(ParallelContext::group_id()) : nullptr;
+  _spr_memo = opts.spr_memo;
+  _spr_memo_reset = true;
+
+  if (ParallelContext::group_size() > 1 && !_spr_search)
   {
     pllmod_treeinfo_set_parallel_context(_pll_treeinfo, (void *) nullptr,
                                          ParallelContext::parallel_reduce_cb);
   }
 
+  /* NB: only the team leader gets a share of the alignment (see balance_load()) */
+  _clv_team = TraversalScheduler::team(ParallelContext::thread_id());
+  _team_member = TraversalScheduler::team_member(ParallelContext::thread_id());
+
   // init partitions
   int optimize_branches = opts.optimize_brlen ? PLLMOD_OPT_PARAM_BRANCHES_ITERATIVE : 0;
   if (opts.optimize_model && opts.brlen_linkage == PLLMOD_TREE_BRLEN_SCALED &&
@@ -64,7 +91,7 @@ void TreeInfo::init(const Options &opts, const Tree& tree, const PartitionedMSA&
       if (!retval)
         throw runtime_error("ERROR adding treeinfo partition: " + string(pll_errmsg));
 
-      if (part_range->master())
+      if (part_range->master() && (!_spr_search || ParallelContext::group_master_thread()))
         _parts_master.insert(p);
     }
     else
@@ -85,14 +112,207 @@ TreeInfo::~TreeInfo ()
   }
 }
 
+TreeInfo::TreeInfo (TreeInfo&& other) :
+    _pll_treeinfo(other._pll_treeinfo), _parts_master(move(other._parts_master)),
+    _loglh(other._loglh), _loglh_valid(other._loglh_valid), _clvs_valid(other._clvs_valid),
+    _modopt(move(other._modopt)),
+    _clv_team(other._clv_team), _team_member(other._team_member), _spr_search(other._spr_search),
+    _spr_memo(other._spr_memo), _spr_memo_reset(other._spr_memo_reset)
+{
+  other._pll_treeinfo = nullptr;
+}
+
+TreeInfo& TreeInfo::operator=(TreeInfo&& other)
+{
+  if (this != &other)
+  {
+    swap(_pll_treeinfo, other._pll_treeinfo);
+    swap(_parts_master, other._parts_master);
+    _loglh = other._loglh;
+    _loglh_valid = other._loglh_valid;
+    _clvs_valid = other._clvs_valid;
+    swap(_modopt, other._modopt);
+    _clv_team = other._clv_team;
+    _team_member = other._team_member;
+    _spr_search = other._spr_search;
+    _spr_memo = other._spr_memo;
+    _spr_memo_reset = other._spr_memo_reset;
+  }
+  return *this;
+}
+
 Tree TreeInfo::tree() const
 {
   return _pll_treeinfo ? Tree(_pll_treeinfo->tip_count, _pll_treeinfo->root) : Tree();
 }
 
+void TreeInfo::tree(const Tree& tree)
+{
+  _pll_treeinfo->root = tree.pll_utree_copy();
+  _loglh_valid = false;
+  _clvs_valid = false;
+  _spr_memo_reset = true;
+  _modopt.reset();
+}
+
+void TreeInfo::loglh_computed(double loglh, bool clvs_valid)
+{
+  _loglh = loglh;
+  _loglh_valid = true;
+  _clvs_valid = clvs_valid;
+}
+
+/* inner nodes in the subtree below node which an incremental traversal would skip
+ * (NB: libpll keeps one validity flag per directed node, i.e. indexed by node_index) */
+static size_t skipped_clvs(const pll_unode_t * node, const char * clv_valid, bool skip)
+{
+  if (!node->next)
+    return 0;
+
+  skip = skip || clv_valid[node->node_index];
+
+  return (skip ? 1 : 0) + skipped_clvs(node->next->back, clv_valid, skip) +
+      skipped_clvs(node->next->next->back, clv_valid, skip);
+}
+
+/* NB: must be called before the evaluation, since it updates the validity flags */
+void TreeInfo::count_skipped_clvs(bool all)
+{
+  const auto& treeinfo = *_pll_treeinfo;
+  size_t local_parts = 0;
+  const char * clv_valid = nullptr;
+  for (size_t p = 0; p < treeinfo.partition_count; ++p)
+  {
+    if (treeinfo.partitions[p])
+    {
+      local_parts++;
+      if (!clv_valid)
+        clv_valid = treeinfo.clv_valid[p];
+    }
+  }
+
+  if (!local_parts)
+    return;
+
+  size_t skipped;
+  if (all)
+    skipped = treeinfo.tip_count - 2;
+  else
+  {
+    skipped = skipped_clvs(treeinfo.root, clv_valid, false) +
+        skipped_clvs(treeinfo.root->back, clv_valid, false);
+  }
+
+  _skipped_clv_updates += skipped * local_parts;
+}
+
 double TreeInfo::loglh(bool incremental)
 {
-  return pllmod_treeinfo_compute_loglh(_pll_treeinfo, incremental ? 1 : 0);
+  if (_loglh_valid)
+  {
+    count_skipped_clvs(true);
+    return _loglh;
+  }
+
+  if (_clvs_valid && !incremental)
+  {
+    count_skipped_clvs(false);
+    incremental = true;
+  }
+
+  /* NB: incremental updates are usually too small to be worth splitting into tasks */
+  if (_clv_team && !incremental)
+  {
+    compute_loglh_tasks();
+
+    if (ParallelContext::group_size() > 1)
+    {
+      ParallelContext::parallel_reduce_cb(nullptr, _pll_treeinfo->partition_loglh,
+                                          _pll_treeinfo->partition_count,
+                                          PLLMOD_TREE_REDUCE_SUM);
+    }
+
+    double total_loglh = 0.;
+    for (size_t p = 0; p < _pll_treeinfo->partition_count; ++p)
+      total_loglh += _pll_treeinfo->partition_loglh[p];
+
+    loglh_computed(total_loglh, true);
+    return total_loglh;
+  }
+
+  loglh_computed(pllmod_treeinfo_compute_loglh(_pll_treeinfo, incremental ? 1 : 0), true);
+  return _loglh;
+}
+
+static int cb_full_traversal(pll_unode_t * node)
+{
+  UNUSED(node);
+  return PLL_SUCCESS;
+}
+
+void TreeInfo::compute_loglh_tasks()
+{
+  auto& treeinfo = *_pll_treeinfo;
+  unsigned int trav_size = 0;
+
+  if (_team_member == 0)
+  {
+    /* team leader: compute P matrices and the post-order list of CLV updates */
+    pllmod_treeinfo_update_prob_matrices(_pll_treeinfo, 1);
+
+    unsigned int ops_count;
+    pll_utree_traverse(treeinfo.root, PLL_TREE_TRAVERSE_POSTORDER, cb_full_traversal,
+                       treeinfo.travbuffer, &trav_size);
+    pll_utree_create_operations(treeinfo.travbuffer, trav_size, NULL, NULL,
+                                treeinfo.operations, NULL, &ops_count);
+
+    vector<pll_partition_t*> partitions;
+    for (size_t p = 0; p < treeinfo.partition_count; ++p)
+    {
+      if (treeinfo.partitions[p])
+        partitions.push_back(treeinfo.partitions[p]);
+    }
+
+    _clv_team->prepare(treeinfo.operations, ops_count, partitions);
+  }
+
+  /* all team members compute CLVs for the leader's partitions */
+  _clv_team->execute(_team_member);
+
+  /* evaluate logLH at the root edge (other team members have no partitions) */
+  const pll_unode_t * root = treeinfo.root;
+  for (size_t p = 0; p < treeinfo.partition_count; ++p)
+  {
+    treeinfo.partition_loglh[p] = treeinfo.partitions[p] ?
+        pll_compute_edge_loglikelihood(treeinfo.partitions[p], root->clv_index,
+                                       root->scaler_index, root->back->clv_index,
+                                       root->back->scaler_index, root->pmatrix_index,
+                                       treeinfo.param_indices[p], NULL) : 0.;
+  }
+
+  if (_team_member == 0)
+    pllmod_treeinfo_validate_clvs(_pll_treeinfo, treeinfo.travbuffer, trav_size);
+}
+
+void TreeInfo::update_clvs()
+{
+  if (_clvs_valid)
+  {
+    count_skipped_clvs(false);
+    return;
+  }
+
+  /* compute local per-partition logLH, but skip the (blocking) reduction in libpll */
+  if (_clv_team)
+    compute_loglh_tasks();
+  else
+  {
+    auto reduce_cb = _pll_treeinfo->parallel_reduce_cb;
+    _pll_treeinfo->parallel_reduce_cb = NULL;
+    pllmod_treeinfo_compute_loglh(_pll_treeinfo, 0);
+    _pll_treeinfo->parallel_reduce_cb = reduce_cb;
+  }
+  _clvs_valid = true;
 }
 
 void TreeInfo::model(size_t partition_id, const Model& model)
@@ -100,6 +320,12 @@ void TreeInfo::model(size_t partition_id, const Model& model)
   if (partition_id >= _pll_treeinfo->partition_count)
     throw out_of_range("Partition ID out of range");
 
+  /* NB: all threads must agree on the cached logLH, so reset it even if the partition
+   * is not assigned to this thread */
+  _loglh_valid = false;
+  _clvs_valid = false;
+  _modopt.reset();
+
   if (!_pll_treeinfo->partitions[partition_id])
     return;
 
@@ -113,11 +339,13 @@ void TreeInfo::model(size_t partition_id, const Model& model)
 
 double TreeInfo::optimize_branches(double lh_epsilon, double brlen_smooth_factor)
 {
-  /* update all CLVs and p-matrices before calling BLO */
-  double new_loglh = loglh();
+  double new_loglh;
 
   if (_pll_treeinfo->params_to_optimize[0] & PLLMOD_OPT_PARAM_BRANCHES_ITERATIVE)
   {
+    /* update all invalid CLVs and p-matrices before calling BLO */
+    update_clvs();
+
     new_loglh = -1 * pllmod_opt_optimize_branch_lengths_local_multi(_pll_treeinfo->partitions,
                                                                     _pll_treeinfo->partition_count,
                                                                     _pll_treeinfo->root,
@@ -138,7 +366,12 @@ double TreeInfo::optimize_branches(double lh_epsilon, double brlen_smooth_factor
 
     if (pll_errno)
       throw runtime_error("ERROR in branch lenght optimization: " + string(pll_errmsg));
+
+    /* NB: BLO updates CLVs and P matrices without touching the validity flags */
+    loglh_computed(new_loglh, false);
   }
+  else
+    new_loglh = loglh();
 
   /* optimize brlen scalers, if needed */
   if (_pll_treeinfo->brlen_linkage == PLLMOD_TREE_BRLEN_SCALED &&
@@ -154,18 +387,160 @@ double TreeInfo::optimize_branches(double lh_epsilon, double brlen_smooth_factor
     pllmod_treeinfo_normalize_brlen_scalers(_pll_treeinfo);
 
     LOG_DEBUG << "\t - after brlen scalers: logLH = " << new_loglh << endl;
+
+    loglh_computed(new_loglh, false);
   }
 
 
   return new_loglh;
 }
 
+/* state of the adaptive model optimization within one optimize_params() call */
+struct TreeInfo::ModelOptPass
+{
+  double loglh;                       /* logLH before the current step (NaN if unknown) */
+  double lh_epsilon;
+  int param;                          /* parameter class optimized in the current step */
+  bool changed;                       /* at least one step was run */
+  std::vector<int> params_to_optimize;  /* per partition, before excluding converged ones */
+  std::vector<doubleVector> values;   /* parameter values before the step (local partitions) */
+
+  /* per-partition parameter changes of a finished step: reduced in background while the next
+   * steps are running, and applied to the scheduler by modopt_pass_finish() */
+  struct StepChange
+  {
+    int param;
+    double gain;
+    std::vector<char> active;         /* partition was optimized in this step */
+    ReduceRequest change_req;
+  };
+  std::list<StepChange> changes;
+};
+
+bool TreeInfo::modopt_step_start(int param, ModelOptPass& pass)
+{
+  if (!_modopt.enabled())
+    return true;
+
+  auto& treeinfo = *_pll_treeinfo;
+
+  pass.param = param;
+  pass.params_to_optimize.assign(treeinfo.params_to_optimize,
+                                 treeinfo.params_to_optimize + treeinfo.partition_count);
+  pass.values.assign(treeinfo.partition_count, doubleVector());
+
+  size_t active = 0;
+  size_t skipped = 0;
+  for (size_t p = 0; p < treeinfo.partition_count; ++p)
+  {
+    if (!(treeinfo.params_to_optimize[p] & param))
+      continue;
+
+    if (_modopt.converged(p, param))
+    {
+      treeinfo.params_to_optimize[p] &= ~param;
+      skipped++;
+    }
+    else
+    {
+      pass.values[p] = ModelOptScheduler::param_values(treeinfo, p, param);
+      active++;
+    }
+  }
+
+  if (ParallelContext::group_master_thread())
+    ModelOptScheduler::count_steps(active + skipped, skipped);
+
+  if (skipped > 0)
+  {
+    LOG_DEBUG << "\t - " << ModelOptScheduler::param_name(param) << ": skipping " << skipped <<
+        " / " << (active + skipped) << " converged partition(s)" << endl;
+  }
+
+  if (!active)
+  {
+    copy(pass.params_to_optimize.cbegin(), pass.params_to_optimize.cend(),
+         treeinfo.params_to_optimize);
+  }
+
+  return active > 0;
+}
+
+void TreeInfo::modopt_step_finish(ModelOptPass& pass, double new_loglh)
+{
+  pass.changed = true;
+
+  if (!_modopt.enabled())
+    return;
+
+  auto& treeinfo = *_pll_treeinfo;
+  const int param = pass.param;
+
+  pass.changes.emplace_back();
+  auto& step = pass.changes.back();
+  step.param = param;
+  step.gain = std::isnan(pass.loglh) ? numeric_limits<double>::infinity() :
+      new_loglh - pass.loglh;
+  step.active.assign(treeinfo.partition_count, 0);
+
+  /* NB: partitions can be split among threads, so take the maximum over the group */
+  doubleVector change(treeinfo.partition_count, 0.);
+  for (size_t p = 0; p < treeinfo.partition_count; ++p)
+  {
+    if (!pass.values[p].empty())
+    {
+      change[p] = ModelOptScheduler::param_change(pass.values[p],
+                                                  ModelOptScheduler::param_values(treeinfo, p,
+                                                                                  param));
+    }
+  }
+
+  for (size_t p = 0; p < treeinfo.partition_count; ++p)
+    step.active[p] = (treeinfo.params_to_optimize[p] & param) ? 1 : 0;
+
+  /* the result is only needed by the next optimize_params() call */
+  ParallelContext::parallel_reduce_start(change.data(), change.size(), PLLMOD_TREE_REDUCE_MAX,
+                                         step.change_req, !treeinfo.parallel_reduce_cb);
+
+  copy(pass.params_to_optimize.cbegin(), pass.params_to_optimize.cend(),
+       treeinfo.params_to_optimize);
+  pass.loglh = new_loglh;
+}
+
+void TreeInfo::modopt_pass_finish(ModelOptPass& pass)
+{
+  for (auto& step: pass.changes)
+  {
+    ParallelContext::parallel_reduce_finish(step.change_req);
+
+    const auto& change = step.change_req.result();
+    for (size_t p = 0; p < change.size(); ++p)
+    {
+      if (step.active[p])
+        _modopt.update(p, step.param, change[p], step.gain, pass.lh_epsilon);
+    }
+  }
+
+  pass.changes.clear();
+}
+
 double TreeInfo::optimize_params(int params_to_optimize, double lh_epsilon)
 {
   double new_loglh;
 
+  ModelOptPass pass;
+  pass.loglh = _loglh_valid ? _loglh : numeric_limits<double>::quiet_NaN();
+  pass.lh_epsilon = lh_epsilon;
+  pass.changed = false;
+
+  /* thread-only groups: reductions of the parameter changes are fused into a single
+   * collective (see modopt_step_finish()), with MPI they overlap with the following steps.
+   * NB: must be closed before the pass is destroyed, since the queue points to its buffers */
+  ParallelContext::ReduceScope reduce_scope("modopt");
+
   /* optimize SUBSTITUTION RATES */
-  if (params_to_optimize & PLLMOD_OPT_PARAM_SUBST_RATES)
+  if ((params_to_optimize & PLLMOD_OPT_PARAM_SUBST_RATES) &&
+      modopt_step_start(PLLMOD_OPT_PARAM_SUBST_RATES, pass))
   {
     new_loglh = -1 * pllmod_algo_opt_subst_rates_treeinfo(_pll_treeinfo,
                                                           0,
@@ -175,10 +550,13 @@ double TreeInfo::optimize_params(int params_to_optimize, double lh_epsilon)
                                                           RAXML_PARAM_EPSILON);
 
     LOG_DEBUG << "\t - after rates: logLH = " << new_loglh << endl;
+
+    modopt_step_finish(pass, new_loglh);
   }
 
   /* optimize BASE FREQS */
-  if (params_to_optimize & PLLMOD_OPT_PARAM_FREQUENCIES)
+  if ((params_to_optimize & PLLMOD_OPT_PARAM_FREQUENCIES) &&
+      modopt_step_start(PLLMOD_OPT_PARAM_FREQUENCIES, pass))
   {
     new_loglh = -1 * pllmod_algo_opt_frequencies_treeinfo(_pll_treeinfo,
                                                           0,
@@ -188,10 +566,13 @@ double TreeInfo::optimize_params(int params_to_optimize, double lh_epsilon)
                                                           RAXML_PARAM_EPSILON);
 
     LOG_DEBUG << "\t - after freqs: logLH = " << new_loglh << endl;
+
+    modopt_step_finish(pass, new_loglh);
   }
 
   /* optimize ALPHA */
-  if (params_to_optimize & PLLMOD_OPT_PARAM_ALPHA)
+  if ((params_to_optimize & PLLMOD_OPT_PARAM_ALPHA) &&
+      modopt_step_start(PLLMOD_OPT_PARAM_ALPHA, pass))
   {
     new_loglh = -1 * pllmod_algo_opt_onedim_treeinfo(_pll_treeinfo,
                                                       PLLMOD_OPT_PARAM_ALPHA,
@@ -200,9 +581,12 @@ double TreeInfo::optimize_params(int params_to_optimize, double lh_epsilon)
                                                       RAXML_PARAM_EPSILON);
 
    LOG_DEBUG << "\t - after alpha: logLH = " << new_loglh << endl;
+
+    modopt_step_finish(pass, new_loglh);
   }
 
-  if (params_to_optimize & PLLMOD_OPT_PARAM_PINV)
+  if ((params_to_optimize & PLLMOD_OPT_PARAM_PINV) &&
+      modopt_step_start(PLLMOD_OPT_PARAM_PINV, pass))
   {
     new_loglh = -1 * pllmod_algo_opt_onedim_treeinfo(_pll_treeinfo,
                                                       PLLMOD_OPT_PARAM_PINV,
@@ -211,10 +595,13 @@ double TreeInfo::optimize_params(int params_to_optimize, double lh_epsilon)
                                                       RAXML_PARAM_EPSILON);
 
     LOG_DEBUG << "\t - after p-inv: logLH = " << new_loglh << endl;
+
+    modopt_step_finish(pass, new_loglh);
   }
 
   /* optimize FREE RATES and WEIGHTS */
-  if (params_to_optimize & PLLMOD_OPT_PARAM_FREE_RATES)
+  if ((params_to_optimize & PLLMOD_OPT_PARAM_FREE_RATES) &&
+      modopt_step_start(PLLMOD_OPT_PARAM_FREE_RATES, pass))
   {
     new_loglh = -1 * pllmod_algo_opt_rates_weights_treeinfo (_pll_treeinfo,
                                                           RAXML_FREERATE_MIN,
@@ -229,24 +616,421 @@ double TreeInfo::optimize_params(int params_to_optimize, double lh_epsilon)
 
     LOG_DEBUG << "\t - after freeR: logLH = " << new_loglh << endl;
 //    LOG_DEBUG << "\t - after freeR/crosscheck: logLH = " << loglh() << endl;
+
+    modopt_step_finish(pass, new_loglh);
+  }
+
+  /* NB: model parameters have changed, and the last evaluation of a line search is not
+   * necessarily done at the optimum */
+  if (pass.changed)
+  {
+    _loglh_valid = false;
+    _clvs_valid = false;
   }
 
   if (params_to_optimize & PLLMOD_OPT_PARAM_BRANCHES_ITERATIVE)
   {
     new_loglh = optimize_branches(lh_epsilon, 0.25);
   }
+  else if (!pass.changed)
+  {
+    /* all parameters have converged */
+    new_loglh = loglh();
+  }
+
+  modopt_pass_finish(pass);
 
   return new_loglh;
 }
 
 double TreeInfo::spr_round(spr_round_params& params)
 {
-  return pllmod_algo_spr_round(_pll_treeinfo, params.radius_min, params.radius_max,
-                               params.ntopol_keep, params.thorough,
-                               RAXML_BRLEN_MIN, RAXML_BRLEN_MAX, RAXML_BRLEN_SMOOTHINGS,
-                               0.1,
-                               params.subtree_cutoff > 0. ? &params.cutoff_info : nullptr,
-                               params.subtree_cutoff);
+  /* NB: model parameters have to be re-checked on the new topology */
+  _modopt.reset();
+
+  if (_spr_search)
+    return spr_round_candidates(params);
+
+  const double new_loglh = pllmod_algo_spr_round(_pll_treeinfo, params.radius_min,
+                                                 params.radius_max, params.ntopol_keep,
+                                                 params.thorough, RAXML_BRLEN_MIN,
+                                                 RAXML_BRLEN_MAX, RAXML_BRLEN_SMOOTHINGS,
+                                                 0.1,
+                                                 params.subtree_cutoff > 0. ?
+                                                     &params.cutoff_info : nullptr,
+                                                 params.subtree_cutoff);
+
+  if (new_loglh)
+    loglh_computed(new_loglh, false);
+  else
+  {
+    _loglh_valid = false;
+    _clvs_valid = false;
+  }
+
+  return new_loglh;
+}
+
+/* candidate-parallel SPR rounds (see SprCandidateSearch) */
+struct TreeInfo::SprRoundState
+{
+  double loglh;                     /* logLH of the tree at the start of the round */
+  double lh_dec_sum;                /* logLH decrease of the rejected moves (subtree cutoff) */
+  size_t lh_dec_count;
+  std::vector<pll_unode_t*> path;   /* nodes between the pruning point and the regraft branch */
+  SprMove best_move;                /* best move found for the current prune node */
+};
+
+/* node_index -> node, for all (sub)nodes of the tree */
+static vector<pll_unode_t*> collect_nodes(pll_unode_t * root)
+{
+  vector<pll_unode_t*> nodes;
+  vector<pll_unode_t*> stack = {root, root->back};
+  while (!stack.empty())
+  {
+    pll_unode_t * node = stack.back();
+    stack.pop_back();
+
+    pll_unode_t * n = node;
+    do
+    {
+      if (n->node_index >= nodes.size())
+        nodes.resize(n->node_index + 1, nullptr);
+      nodes[n->node_index] = n;
+      if (n != node)
+        stack.push_back(n->back);
+      n = n->next;
+    }
+    while (n && n != node);
+  }
+  return nodes;
+}
+
+/* all subnodes up to radius nodes away from node (in the direction node is pointing to) */
+static void collect_neighbors(pll_unode_t * node, unsigned int radius,
+                              vector<pll_unode_t*>& nodes)
+{
+  nodes.push_back(node);
+  if (node->next)
+  {
+    nodes.push_back(node->next);
+    nodes.push_back(node->next->next);
+    if (radius > 0)
+    {
+      collect_neighbors(node->next->back, radius - 1, nodes);
+      collect_neighbors(node->next->next->back, radius - 1, nodes);
+    }
+  }
+}
+
+static bool find_path(pll_unode_t * node, const pll_unode_t * r, vector<pll_unode_t*>& path)
+{
+  if (node == r || node->back == r)
+    return true;
+  else if (!node->next)
+    return false;
+
+  path.push_back(node);
+  if (find_path(node->next->back, r, path) || find_path(node->next->next->back, r, path))
+    return true;
+  path.pop_back();
+  return false;
+}
+
+/* path from the pruning point at p to the branch (r, r->back), see SprRoundState::path;
+ * returns false if the move is not valid (anymore), i.e. if r is part of the pruned subtree
+ * or adjacent to the pruning point */
+static bool find_regraft_path(pll_unode_t * p, const pll_unode_t * r,
+                              vector<pll_unode_t*>& path)
+{
+  for (auto node: {p, p->next, p->next->next})
+  {
+    if (r == node || r->back == node)
+      return false;
+  }
+
+  for (auto e: {p->next->back, p->next->next->back})
+  {
+    path.clear();
+    if (find_path(e, r, path))
+      return true;
+  }
+  return false;
+}
+
+void TreeInfo::invalidate_clvs(const pll_unode_t * node)
+{
+  const pll_unode_t * n = node;
+  do
+  {
+    pllmod_treeinfo_invalidate_clv(_pll_treeinfo, n);
+    n = n->next;
+  }
+  while (n && n != node);
+}
+
+/* after a topology change around node: invalidate all CLVs whose subtree contains node, i.e.
+ * all but the one pointing away from node in every other node */
+void TreeInfo::invalidate_clvs_towards(pll_unode_t * node)
+{
+  invalidate_clvs(node);
+
+  vector<pll_unode_t*> stack = {node->back, node->next->back, node->next->next->back};
+  while (!stack.empty())
+  {
+    pll_unode_t * n = stack.back();
+    stack.pop_back();
+
+    if (!n->next)
+      continue;
+
+    for (auto sibling: {n->next, n->next->next})
+    {
+      pllmod_treeinfo_invalidate_clv(_pll_treeinfo, sibling);
+      stack.push_back(sibling->back);
+    }
+  }
+}
+
+/* apply the SPR move (p, r) and compute the new logLH (with local branch length optimization
+ * in thorough mode); the move is reverted unless the new logLH exceeds keep_loglh */
+double TreeInfo::spr_move(pll_unode_t * p, pll_unode_t * r, const std::vector<pll_unode_t*>& path,
+                          bool thorough, double keep_loglh)
+{
+  pll_unode_t * e1 = p->next->back;
+  pll_unode_t * e2 = p->next->next->back;
+
+  /* CLVs pointing towards the pruning or the regraft point and P matrices of all branches
+   * involved (before and after the move) */
+  auto invalidate = [this, p, r, e1, e2, &path]()
+      {
+        for (auto node: path)
+          invalidate_clvs(node);
+        for (auto node: {p, e1, e2})
+          invalidate_clvs(node);
+        for (auto node: {p, p->next, p->next->next, e1, e2, r, r->back})
+          pllmod_treeinfo_invalidate_pmatrix(_pll_treeinfo, node);
+      };
+
+  pll_tree_rollback_t rollback;
+  if (!pllmod_utree_spr(p, r, &rollback))
+    throw runtime_error("ERROR in SPR move: " + string(pll_errmsg));
+
+  invalidate();
+  _pll_treeinfo->root = p;
+
+  double new_loglh = pllmod_treeinfo_compute_loglh(_pll_treeinfo, 1);
+
+  vector<pll_unode_t*> neighbors;
+  doubleVector lengths;
+  if (thorough)
+  {
+    /* branches around the inserted subtree (NB: BLO updates CLVs on its own) */
+    collect_neighbors(p, 2, neighbors);
+    collect_neighbors(p->back, 1, neighbors);
+    for (auto node: neighbors)
+      lengths.push_back(node->length);
+
+    new_loglh = -1 * pllmod_opt_optimize_branch_lengths_local_multi(_pll_treeinfo->partitions,
+                                                                    _pll_treeinfo->partition_count,
+                                                                    p,
+                                                                    _pll_treeinfo->param_indices,
+                                                                    _pll_treeinfo->deriv_precomp,
+                                                                    _pll_treeinfo->brlen_scalers,
+                                                                    RAXML_BRLEN_MIN,
+                                                                    RAXML_BRLEN_MAX,
+                                                                    0.1,
+                                                                    RAXML_BRLEN_SMOOTHINGS,
+                                                                    1,    /* radius */
+                                                                    1,    /* keep_update */
+                                                                    nullptr,
+                                                                    nullptr);
+
+    for (auto node: neighbors)
+    {
+      invalidate_clvs(node);
+      pllmod_treeinfo_invalidate_pmatrix(_pll_treeinfo, node);
+    }
+  }
+
+  if (new_loglh > keep_loglh)
+  {
+    /* NB: CLVs elsewhere in the tree might still reflect the old topology */
+    invalidate_clvs_towards(p);
+    return new_loglh;
+  }
+
+  /* revert: restore branch lengths changed by BLO first, then the topology */
+  for (size_t i = 0; i < neighbors.size(); ++i)
+  {
+    neighbors[i]->length = lengths[i];
+    neighbors[i]->back->length = lengths[i];
+  }
+
+  if (!pllmod_tree_rollback(&rollback))
+    throw runtime_error("ERROR reverting SPR move: " + string(pll_errmsg));
+
+  invalidate();
+  for (auto node: neighbors)
+  {
+    invalidate_clvs(node);
+    pllmod_treeinfo_invalidate_pmatrix(_pll_treeinfo, node);
+  }
+
+  return new_loglh;
+}
+
+/* evaluate all regraft positions behind branch (r, r->back) for the subtree pruned at p */
+void TreeInfo::spr_descend(pll_unode_t * p, pll_unode_t * r, int depth,
+                           const spr_round_params& params, SprRoundState& state)
+{
+  bool descend = depth < params.radius_max && r->next;
+
+  if (depth >= params.radius_min)
+  {
+    const double new_loglh = spr_move(p, r, state.path, params.thorough,
+                                      numeric_limits<double>::infinity());
+
+    if (new_loglh > state.best_move.loglh)
+      state.best_move = {new_loglh, p->node_index, r->node_index};
+    else if (new_loglh < state.loglh)
+    {
+      state.lh_dec_sum += state.loglh - new_loglh;
+      state.lh_dec_count++;
+
+      /* subtree cutoff: do not descend further if this position is much worse */
+      if (params.subtree_cutoff > 0. && new_loglh < state.loglh - params.cutoff_info.lh_cutoff)
+        descend = false;
+    }
+  }
+
+  if (descend)
+  {
+    state.path.push_back(r);
+    spr_descend(p, r->next->back, depth + 1, params, state);
+    spr_descend(p, r->next->next->back, depth + 1, params, state);
+    state.path.pop_back();
+  }
+}
+
+/* memo record for prune node p: covers all regraft positions and the pruned subtree */
+static SprMemoEntry spr_memo_entry(const pll_unode_t * p, const spr_round_params& params)
+{
+  return {spr_topology_hash(p, params.radius_max), params.radius_min, params.radius_max,
+          params.thorough != 0};
+}
+
+/* SPR round with threads of a group evaluating different prune nodes on their own tree copies;
+ * the best moves are then applied by all threads in the same order */
+double TreeInfo::spr_round_candidates(spr_round_params& params)
+{
+  auto& search = *_spr_search;
+  auto& treeinfo = *_pll_treeinfo;
+
+  /* NB: moves are evaluated incrementally, so CLVs must not be stale */
+  if (!_clvs_valid)
+    _loglh_valid = false;
+
+  SprRoundState state;
+  state.loglh = loglh();
+  state.lh_dec_sum = 0.;
+  state.lh_dec_count = 0;
+
+  /* NB: node indices and traversal order are the same in all tree copies */
+  pll_unode_t * root = treeinfo.root;
+  auto nodes = collect_nodes(root);
+  vector<unsigned int> prune_nodes;
+  for (auto node: nodes)
+  {
+    if (node && node->next)
+      prune_nodes.push_back(node->node_index);
+  }
+
+  ParallelContext::thread_barrier();
+  if (ParallelContext::group_master_thread())
+  {
+    search.reset(max<size_t>(params.ntopol_keep, SPR_CANDIDATES_MIN_MOVES), nodes.size(),
+                 _spr_memo_reset);
+  }
+  _spr_memo_reset = false;
+  ParallelContext::thread_barrier();
+
+  /* prune nodes are handed out dynamically, since the number of regraft positions varies */
+  size_t memo_skipped = 0;
+  for (size_t i = search.next_prune(); i < prune_nodes.size(); i = search.next_prune())
+  {
+    pll_unode_t * p = nodes[prune_nodes[i]];
+    state.best_move = {state.loglh, 0, 0};
+
+    SprMemoEntry memo_entry;
+    if (_spr_memo)
+    {
+      memo_entry = spr_memo_entry(p, params);
+      if (search.memo_hit(p->node_index, memo_entry))
+      {
+        memo_skipped++;
+        continue;
+      }
+    }
+
+    for (auto e: {p->next->back, p->next->next->back})
+    {
+      if (!e->next)
+        continue;
+
+      state.path.assign(1, e);
+      spr_descend(p, e->next->back, 1, params, state);
+      spr_descend(p, e->next->next->back, 1, params, state);
+    }
+
+    if (state.best_move.loglh > state.loglh)
+    {
+      search.best_moves().insert(state.best_move);
+      if (_spr_memo)
+        search.memo_clear(p->node_index);
+    }
+    else if (_spr_memo)
+      search.memo_store(p->node_index, memo_entry);
+  }
+  treeinfo.root = root;
+
+  /* statistics for the subtree cutoff (and the memo), summed over all threads */
+  double dec_stats[3] = {state.lh_dec_sum, (double) state.lh_dec_count, (double) memo_skipped};
+  ParallelContext::thread_reduce(dec_stats, 3, PLLMOD_TREE_REDUCE_SUM);
+
+  if (_spr_memo)
+  {
+    LOG_DEBUG << "\t - SPR memo: skipped " << (size_t) dec_stats[2] << " / " <<
+        prune_nodes.size() << " prune nodes" << endl;
+  }
+
+  if (params.subtree_cutoff > 0. && dec_stats[1] > 0.)
+  {
+    auto& cutoff_info = params.cutoff_info;
+    cutoff_info.lh_dec_sum += dec_stats[0];
+    cutoff_info.lh_dec_count += (int) dec_stats[1];
+    cutoff_info.lh_cutoff = cutoff_info.lh_dec_sum / cutoff_info.lh_dec_count *
+        params.subtree_cutoff;
+  }
+
+  /* NB: the reduction above is also a barrier, so all moves have been inserted by now.
+   * Moves are re-evaluated, since earlier ones might have changed the tree around them */
+  double cur_loglh = state.loglh;
+  vector<pll_unode_t*> path;
+  for (auto const& move: search.best_moves().sorted())
+  {
+    pll_unode_t * p = nodes[move.prune_index];
+    pll_unode_t * r = nodes[move.regraft_index];
+    if (!find_regraft_path(p, r, path))
+      continue;
+
+    const double new_loglh = spr_move(p, r, path, params.thorough, cur_loglh);
+    if (new_loglh > cur_loglh)
+      cur_loglh = new_loglh;
+  }
+
+  loglh_computed(cur_loglh, true);
+  return cur_loglh;
 }
 
 
@@ -344,9 +1128,12 @@ void set_partition_tips(const Options& opts, const MSA& msa, const PartitionRang
   }
   else
   {
+    /* NB: MSA might be a slice which doesn't start at the first column */
+    assert(part_region.start >= msa.seq_offset());
+    const size_t seq_start = part_region.start - msa.seq_offset();
     for (size_t i = 0; i < msa.size(); ++i)
     {
-      pll_set_tip_states(partition, i, partition->map, msa.at(i).c_str() + part_region.start);
+      pll_set_tip_states(partition, i, partition->map, msa.at(i).c_str() + seq_start);
     }
   }
 }
@@ -388,6 +1175,7 @@ void set_partition_tips(const Options& opts, const MSA& msa, const PartitionRang
   }
   else
   {
+    assert(pstart >= msa.seq_offset());
     std::vector<char> bs_seq(part_region.length);
     for (size_t i = 0; i < msa.size(); ++i)
     {
@@ -396,7 +1184,7 @@ void set_partition_tips(const Options& opts, const MSA& msa, const PartitionRang
       for (size_t j = pstart; j < pend; ++j)
       {
         if (weights[j] > 0)
-          bs_seq[pos++] = full_seq[j];
+          bs_seq[pos++] = full_seq[j - msa.seq_offset()];
       }
       assert(pos == comp_weights.size());
 
@@ -413,6 +1201,10 @@ pll_partition_t* create_pll_partition(const Options& opts, const PartitionInfo&
   const MSA& msa = pinfo.msa();
   const Model& model = pinfo.model();
 
+  /* partition must be created by the thread which will use it, and after this thread has been
+   * pinned: CLVs, p-matrices etc. will then be allocated in the local NUMA node (first touch) */
+  assert(ParallelContext::thread_placed() || ParallelContext::thread_cpus().empty());
+
   unsigned int attrs = opts.simd_arch;
 
   if (opts.use_rate_scalers && model.num_ratecats() > 1)
@@ -430,8 +1222,7 @@ pll_partition_t* create_pll_partition(const Options& opts, const PartitionInfo&
   {
     assert(!(opts.use_prob_msa));
     // TODO: use proper auto-tuning
-    const unsigned long min_len_ti = 100;
-    if ((unsigned long) msa.length() > min_len_ti)
+    if ((unsigned long) msa.length() > RAXML_TIP_INNER_MIN_LENGTH)
       attrs |= PLL_ATTRIB_PATTERN_TIP;
   }
 
@@ -1,10 +1,16 @@
 #ifndef RAXML_TREEINFO_HPP_
 #define RAXML_TREEINFO_HPP_
 
+#include <atomic>
+
 #include "common.h"
 #include "Tree.hpp"
 #include "Options.hpp"
 #include "PartitionAssignment.hpp"
+#include "ModelOptScheduler.hpp"
+
+class TraversalScheduler;
+class SprCandidateSearch;
 
 struct spr_round_params
 {
@@ -33,11 +39,18 @@ public:
   virtual
   ~TreeInfo ();
 
+  TreeInfo(const TreeInfo& other) = delete;
+  TreeInfo& operator=(const TreeInfo& other) = delete;
+
+  /* NB: allows to replace the TreeInfo of a running search, e.g. after data re-distribution */
+  TreeInfo(TreeInfo&& other);
+  TreeInfo& operator=(TreeInfo&& other);
+
   const pllmod_treeinfo_t& pll_treeinfo() const { return *_pll_treeinfo; }
   const pll_utree& pll_utree_root() const { assert(_pll_treeinfo); return *_pll_treeinfo->root; }
 
   Tree tree() const;
-  void tree(const Tree& tree) { _pll_treeinfo->root = tree.pll_utree_copy(); }
+  void tree(const Tree& tree);
 
   /* in parallel mode, partition can be share among multiple threads and TreeInfo objects;
    * this method returns list of partition IDs for which this thread is designated as "master"
@@ -46,7 +59,10 @@ public:
 
   void model(size_t partition_id, const Model& model);
 
+  /* NB: returns the cached value if neither the tree nor the model were changed since the last
+   * evaluation, and only recomputes invalidated CLVs if their validity flags can be trusted */
   double loglh(bool incremental = false);
+
   double optimize_params(int params_to_optimize, double lh_epsilon);
   double optimize_params_all(double lh_epsilon)
   { return optimize_params(PLLMOD_OPT_PARAM_ALL, lh_epsilon); } ;
@@ -55,10 +71,64 @@ public:
   double optimize_branches(double lh_epsilon, double brlen_smooth_factor);
   double spr_round(spr_round_params& params);
 
+  /* number of CLV updates (summed over partitions and local threads) saved by cached or
+   * incremental logLH evaluations, compared to a full traversal */
+  static unsigned long long skipped_clv_updates() { return _skipped_clv_updates; }
+
 private:
   pllmod_treeinfo_t * _pll_treeinfo;
   IDSet _parts_master;
 
+  /* logLH of the current tree and model (valid only if _loglh_valid is set) */
+  double _loglh;
+  bool _loglh_valid;
+
+  /* false if the tree or the model were changed without updating the CLV/P matrix validity
+   * flags in _pll_treeinfo, i.e. the next evaluation must recompute all of them */
+  bool _clvs_valid;
+
+  static std::atomic<unsigned long long> _skipped_clv_updates;
+
+  void loglh_computed(double loglh, bool clvs_valid);
+  void count_skipped_clvs(bool all);
+
+  /* adaptive model optimization: converged partitions are excluded from an optimization step,
+   * which is skipped altogether (modopt_step_start() returns false) if nothing is left */
+  ModelOptScheduler _modopt;
+
+  struct ModelOptPass;
+  bool modopt_step_start(int param, ModelOptPass& pass);
+  void modopt_step_finish(ModelOptPass& pass, double new_loglh);
+  void modopt_pass_finish(ModelOptPass& pass);
+
+  /* task-parallel CLV updates: team of threads sharing the partitions of the team leader */
+  TraversalScheduler * _clv_team;
+  size_t _team_member;
+
+  /* full traversal with task-parallel CLV updates, results in partition_loglh (not reduced) */
+  void compute_loglh_tasks();
+
+  /* update all invalid CLVs and compute per-partition logLH, without reduction */
+  void update_clvs();
+
+  /* candidate-parallel SPR rounds: every thread holds the whole alignment and shares the best
+   * moves with the other threads of its group (nullptr for site-parallel SPR rounds) */
+  SprCandidateSearch * _spr_search;
+
+  /* skip prune nodes without improving moves in an earlier round and an unchanged
+   * neighborhood; the memo is discarded on the next round after the tree was replaced */
+  bool _spr_memo;
+  bool _spr_memo_reset;
+
+  struct SprRoundState;
+  double spr_round_candidates(spr_round_params& params);
+  void spr_descend(pll_unode_t * p, pll_unode_t * r, int depth, const spr_round_params& params,
+                   SprRoundState& state);
+  double spr_move(pll_unode_t * p, pll_unode_t * r, const std::vector<pll_unode_t*>& path,
+                  bool thorough, double keep_loglh);
+  void invalidate_clvs(const pll_unode_t * node);
+  void invalidate_clvs_towards(pll_unode_t * node);
+
   void init(const Options &opts, const Tree& tree, const PartitionedMSA& parted_msa,
             const PartitionAssignment& part_assign, const std::vector<uintVector>& site_weights);
 };
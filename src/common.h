@@ -46,6 +46,23 @@ extern "C" {
 #define RAXML_BRLEN_SCALER_MIN    0.01
 #define RAXML_BRLEN_SCALER_MAX    100.
 
+/* use tip-inner lookup tables for alignments longer than this */
+#define RAXML_TIP_INNER_MIN_LENGTH 100
+
+/* site-parallel likelihood computations are dominated by synchronization below this number of
+ * patterns per thread: auto-select candidate-parallel SPR rounds, allow task-parallel CLV updates */
+#define RAXML_SITE_PARALLEL_MIN_PATTERNS 200
+
+/* racing multi-start search (--race auto): cull starting trees more than this many standard
+ * deviations of the logLH values below the best one */
+#define RAXML_RACE_AUTO_SD        2.
+
+/* adaptive model optimization: a parameter class of a partition is considered converged if an
+ * optimization step changed its values by less than RAXML_MODOPT_MIN_CHANGE (relative), or
+ * gained less than RAXML_MODOPT_MIN_GAIN * lh_epsilon logLH units in total */
+#define RAXML_MODOPT_MIN_CHANGE   0.01
+#define RAXML_MODOPT_MIN_GAIN     0.1
+
 /* used to supress compiler warnings about unused args */
 #define UNUSED(expr) while (0) { (void)(expr); }
 
@@ -82,6 +82,63 @@ BasicBinaryStream& operator>>(BasicBinaryStream& stream, Model& m)
   return stream;
 }
 
+BasicBinaryStream& operator<<(BasicBinaryStream& stream, const std::string& s)
+{
+  stream << s.length();
+  stream.put(s.c_str(), s.length());
+
+  return stream;
+}
+
+BasicBinaryStream& operator>>(BasicBinaryStream& stream, std::string& s)
+{
+  auto len = stream.get<size_t>();
+  s.resize(len);
+  stream.get(&s[0], len);
+
+  return stream;
+}
+
+BasicBinaryStream& operator<<(BasicBinaryStream& stream, const MSASlice& s)
+{
+  const MSA& msa = s.msa;
+
+  assert(s.offset + s.length <= msa.length());
+
+  stream << msa.num_sites();
+  stream << msa.weights();
+  stream << s.offset;
+  stream << msa.size();
+  for (size_t i = 0; i < msa.size(); ++i)
+  {
+    stream << (msa.label_id_map().empty() ? std::string() : msa.label(i));
+
+    /* same format as string I/O, but without copying the sequence */
+    stream << s.length;
+    stream.put(msa.at(i).c_str() + s.offset, s.length);
+  }
+
+  return stream;
+}
+
+BasicBinaryStream& operator>>(BasicBinaryStream& stream, MSA& msa)
+{
+  auto num_sites = stream.get<size_t>();
+  auto weights = stream.get<WeightVector>();
+  auto offset = stream.get<size_t>();
+
+  msa = MSA(num_sites, std::move(weights), offset);
+
+  auto count = stream.get<size_t>();
+  for (size_t i = 0; i < count; ++i)
+  {
+    auto label = stream.get<std::string>();
+    msa.append(stream.get<std::string>(), label);
+  }
+
+  return stream;
+}
+
 BasicBinaryStream& operator<<(BasicBinaryStream& stream, const TreeCollection& c)
 {
   stream << c.size();
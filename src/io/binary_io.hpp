@@ -151,6 +151,29 @@ BasicBinaryStream& operator<<(BasicBinaryStream& stream, const Model& m);
 
 BasicBinaryStream& operator>>(BasicBinaryStream& stream, Model& m);
 
+/**
+ * string I/O: length + characters
+ */
+BasicBinaryStream& operator<<(BasicBinaryStream& stream, const std::string& s);
+BasicBinaryStream& operator>>(BasicBinaryStream& stream, std::string& s);
+
+/**
+ * MSA I/O: pattern weights and labels of the whole alignment, but only the columns
+ * [offset, offset + length) of every sequence (-> MSA slice on the receiving side)
+ */
+struct MSASlice
+{
+  MSASlice(const MSA& msa, size_t offset, size_t length) :
+    msa(msa), offset(offset), length(length) {}
+
+  const MSA& msa;
+  size_t offset;
+  size_t length;
+};
+
+BasicBinaryStream& operator<<(BasicBinaryStream& stream, const MSASlice& s);
+BasicBinaryStream& operator>>(BasicBinaryStream& stream, MSA& msa);
+
 /**
  * TreeCollection I/O
  */
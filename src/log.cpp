@@ -1,8 +1,59 @@
+#include <sstream>
+#include <mutex>
+
 #include "log.hpp"
 #include "common.h"
 
 using namespace std;
 
+/* line-buffered output of a worker group master thread: complete lines are written at once
+ * (and optionally tagged with the worker number), so that lines of concurrent workers
+ * don't interleave */
+class WorkerLineBuffer : public std::stringbuf
+{
+public:
+  WorkerLineBuffer(LogStream& target, bool tag) : _target(target), _tag(tag) {}
+
+protected:
+  int sync() override;
+
+private:
+  LogStream& _target;
+  bool _tag;
+  string _partial;    /* incomplete last line */
+
+  static std::mutex _mutex;
+};
+
+std::mutex WorkerLineBuffer::_mutex;
+
+int WorkerLineBuffer::sync()
+{
+  const string buf = _partial + str();
+  const size_t end = buf.rfind('\n');
+  str("");
+  _partial = end == string::npos ? buf : buf.substr(end + 1);
+  if (end == string::npos)
+    return 0;
+
+  const string worker = _tag ? " (worker #" + to_string(ParallelContext::group_id() + 1) + ")" : "";
+
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    /* NB: empty lines are only used for spacing, skip them */
+    istringstream lines(buf.substr(0, end));
+    string line;
+    while (getline(lines, line))
+    {
+      if (!line.empty())
+        _target << line << worker << endl;
+    }
+  }
+
+  return 0;
+}
+
 void LogStream::add_stream(std::ostream* stream)
 {
   if (stream)
@@ -25,12 +76,41 @@ Logging& Logging::instance()
   return instance;
 }
 
-LogStream& Logging::logstream(LogLevel level)
+LogStream& Logging::logstream(LogLevel level, LogScope scope)
 {
-  if (ParallelContext::master() && level <= _log_level)
-    return _full_stream;
-  else
+  if (level > _log_level)
     return _empty_stream;
+
+  /* with multiple worker groups, output of the group masters is written line by line, and
+   * search progress and debug output is tagged with the worker number (see WorkerLineBuffer) */
+  const bool groups = ParallelContext::num_groups() > 1;
+
+  if (scope == LogScope::worker)
+  {
+    if (!ParallelContext::group_master())
+      return _empty_stream;
+    return groups ? worker_stream(false) : _full_stream;
+  }
+
+  if (groups && (level == LogLevel::progress || level == LogLevel::debug))
+    return ParallelContext::group_master() ? worker_stream(true) : _empty_stream;
+
+  return ParallelContext::master() ? _full_stream : _empty_stream;
+}
+
+LogStream& Logging::worker_stream(bool tag)
+{
+  static thread_local WorkerLineBuffer buf(_full_stream, false);
+  static thread_local WorkerLineBuffer tagged_buf(_full_stream, true);
+  static thread_local std::ostream stream(&buf);
+  static thread_local std::ostream tagged_stream(&tagged_buf);
+  static thread_local LogStream logstream(StreamList(1, &stream));
+  static thread_local LogStream tagged_logstream(StreamList(1, &tagged_stream));
+
+  auto& s = tag ? tagged_stream : stream;
+  s << fixed;
+
+  return tag ? tagged_logstream : logstream;
 }
 
 void Logging::set_log_filename(const std::string& fname)
@@ -16,6 +16,12 @@ enum class LogLevel
   debug
 };
 
+enum class LogScope
+{
+  master,   /* global master only */
+  worker    /* master thread of every worker group */
+};
+
 struct TimeStamp
 {
   TimeStamp();
@@ -51,7 +57,7 @@ class Logging
 public:
   static Logging& instance();
 
-  LogStream& logstream(LogLevel level);
+  LogStream& logstream(LogLevel level, LogScope scope = LogScope::master);
   LogLevel log_level() const;
 
   void set_log_filename(const std::string& fname);
@@ -71,6 +77,8 @@ private:
   std::ofstream _logfile;
   LogStream _empty_stream;
   LogStream _full_stream;
+
+  LogStream& worker_stream(bool tag);
 };
 
 Logging& logger();
@@ -85,6 +93,7 @@ Logging& logger();
 #define LOG_VERB RAXML_LOG(LogLevel::verbose)
 
 #define LOG_INFO_TS LOG_INFO << "[" << TimeStamp() << "] "
+#define LOG_WORKER_TS(level) logger().logstream(level, LogScope::worker) << "[" << TimeStamp() << "] "
 #define LOG_VERB_TS LOG_VERB << "[" << TimeStamp() << "] "
 #define LOG_PROGRESS(loglh) LOG_PROGR << ProgressInfo(loglh)
 
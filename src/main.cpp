@@ -20,8 +20,12 @@
 */
 #include <algorithm>
 #include <chrono>
+#include <atomic>
+#include <cmath>
+#include <numeric>
 
 #include <memory>
+#include <set>
 
 #include "version.h"
 #include "common.h"
@@ -35,6 +39,10 @@
 #include "io/binary_io.hpp"
 #include "ParallelContext.hpp"
 #include "LoadBalancer.hpp"
+#include "ParallelBenchmark.hpp"
+#include "ParallelPlanner.hpp"
+#include "TraversalScheduler.hpp"
+#include "SprCandidateSearch.hpp"
 #include "bootstrap/BootstrapGenerator.hpp"
 
 using namespace std;
@@ -46,7 +54,19 @@ struct RaxmlInstance
   PartitionedMSA parted_msa;
   TreeList start_trees;
   BootstrapReplicateList bs_reps;
-  PartitionAssignmentList proc_part_assign;
+  std::vector<size_t> bs_nums;    /* replicate number of every entry in bs_reps */
+
+  /* data distribution within every worker group: groups only differ if thread speeds do */
+  std::vector<PartitionAssignmentList> group_part_assign;
+
+  /* heterogeneous cores: relative speed of every thread, empty if all are equally fast */
+  doubleVector thread_speeds;
+
+  /* partition sizes with estimated per-site costs (input for the load balancer) */
+  PartitionAssignment part_sizes;
+
+  /* MPI job queue: data distribution among the threads of a single rank (for bootstraps) */
+  PartitionAssignmentList rank_part_assign;
   unique_ptr<BootstrapTree> bs_tree;
 
   unique_ptr<NewickStream> start_tree_stream;
@@ -54,6 +74,25 @@ struct RaxmlInstance
   /* this is just a dummy random tree used for convenience, e,g, if we need tip labels or
    * just 'any' valid tree for the alignment at hand */
   Tree random_tree;
+
+  /* job counters for coarse-grained parallelization: worker groups pull
+   * starting trees and bootstrap replicates from the lists above */
+  mutable std::atomic<size_t> next_start_tree{0};
+  mutable std::atomic<size_t> next_bs_rep{0};
+};
+
+/* racing multi-start search: state of every starting tree after the FAST SPR phase, time
+ * spent by the worker group before and after that point, and the trees which survived.
+ * Shared by all threads, every entry is written by the group which processed the tree */
+struct RaceState
+{
+  std::vector<Checkpoint> states;
+  doubleVector fast_times;
+  doubleVector slow_times;
+  std::vector<size_t> survivors;
+  std::atomic<size_t> next_tree{0};
+
+  bool active() const { return !states.empty(); }
 };
 
 void print_banner()
@@ -360,6 +399,7 @@ void load_checkpoint(RaxmlInstance& instance, CheckpointManager& cm)
     LOG_INFO_TS << "NOTE: Resuming execution from checkpoint " <<
         "(logLH: " << ckp.loglh() <<
         ", ML trees: " << ckp.ml_trees.size() <<
+        (ckp.culled_trees ? ", culled: " + to_string(ckp.culled_trees) : "") <<
         ", bootstraps: " << ckp.bs_trees.size() <<
         ")"
         << endl;
@@ -402,7 +442,7 @@ void build_start_trees(RaxmlInstance& instance, CheckpointManager& cm)
     }
 
     // TODO: skip generation
-    if (i < cm.checkpoint().ml_trees.size())
+    if (i < cm.checkpoint().ml_trees.size() + cm.checkpoint().culled_trees)
       continue;
 
     /* fix missing branch lengths */
@@ -422,41 +462,504 @@ void build_start_trees(RaxmlInstance& instance, CheckpointManager& cm)
   }
 }
 
-void balance_load(RaxmlInstance& instance)
+/* MPI: ranks infer bootstrap trees independently and get replicates from rank 0 on demand */
+bool use_bs_queue(const Options& opts)
 {
-  PartitionAssignment part_sizes;
+  return opts.mpi_bs_queue && ParallelContext::num_ranks() > 1 && opts.num_bootstraps > 0;
+}
+
+/* task-parallel CLV updates: sites are distributed among team leaders only, the other
+ * threads of a team work on the leader's data */
+PartitionAssignmentList expand_teams(PartitionAssignmentList&& slices, size_t team_size)
+{
+  if (team_size == 1)
+    return move(slices);
+
+  PartitionAssignmentList result;
+  for (auto& slice: slices)
+  {
+    result.emplace_back(move(slice));
+    result.resize(result.size() + team_size - 1);
+  }
+  return result;
+}
+
+/* data distribution for the worker group of the calling thread */
+const PartitionAssignmentList& group_part_assign(const RaxmlInstance& instance)
+{
+  const auto& group_assign = instance.group_part_assign;
+  return group_assign.size() > 1 ? group_assign.at(ParallelContext::group_id()) :
+                                   group_assign.at(0);
+}
+
+/* capacities of the data slices of the given worker group, i.e. summed speeds of the
+ * team members (empty if all threads are equally fast) */
+doubleVector slice_capacities(const RaxmlInstance& instance, size_t group_id)
+{
+  const auto& speeds = instance.thread_speeds;
+  if (speeds.empty())
+    return doubleVector();
+
+  /* NB: thread speeds are only measured for a single rank */
+  const size_t team_size = instance.opts.clv_task_threads;
+  const size_t group_threads = ParallelContext::num_threads() / ParallelContext::num_groups();
+  doubleVector capacities(group_threads / team_size, 0.);
+  for (size_t i = 0; i < group_threads; ++i)
+    capacities[i / team_size] += speeds.at(group_id * group_threads + i);
+
+  return capacities;
+}
+
+/* heterogeneous cores (e.g. performance and efficiency cores, different turbo frequencies):
+ * measure relative speed of the threads, such that the faster ones get more data */
+void calibrate_thread_speeds(RaxmlInstance& instance)
+{
+  instance.thread_speeds.clear();
+
+  /* NB: speeds can only be attributed to pinned threads; MPI ranks are assumed to be equally
+   * fast, and workers spinning at the barrier would distort the measurement */
+  const auto& cpus = ParallelContext::thread_cpus();
+  if (ParallelContext::num_ranks() > 1 || cpus.size() < 2 ||
+      instance.opts.barrier_mode == BarrierMode::spin ||
+      instance.opts.spr_mode == SprMode::candidates)
+    return;
+
+  CalibrationCache cache;
+  cache.load();
+
+  ParallelPlanner planner(instance.opts, cache);
+  instance.thread_speeds = planner.thread_speeds(cpus);
+
+  if (cache.modified() && !cache.save())
+    LOG_DEBUG << "Failed to write calibration data to: " << cache.fname() << endl;
+
+  if (!instance.thread_speeds.empty())
+  {
+    LOG_INFO_TS << "Heterogeneous cores, relative thread speeds:";
+    for (auto speed: instance.thread_speeds)
+      LOG_INFO << " " << FMT_PREC3(speed);
+    LOG_INFO << endl << endl;
+  }
+}
+
+/* task-parallel CLV updates are only used for full traversals: during branch length, model and
+ * SPR optimization in libpll, team members other than the leader are idle. So teams only pay
+ * off if site-parallel slices would be too small to scale anyway */
+void choose_clv_tasks(RaxmlInstance& instance)
+{
+  auto& clv_task_threads = instance.opts.clv_task_threads;
+  if (clv_task_threads < 2)
+    return;
+
+  /* NB: teams must not span multiple worker groups */
+  const size_t patterns_per_thread = instance.parted_msa.total_length() /
+      ParallelContext::group_size();
+  if ((ParallelContext::num_threads() / ParallelContext::num_groups()) % clv_task_threads != 0)
+  {
+    LOG_WARN << "WARNING: Number of threads per worker is not a multiple of " <<
+        clv_task_threads << ", task-parallel CLV updates will be disabled." << endl << endl;
+    clv_task_threads = 1;
+  }
+  else if (patterns_per_thread >= RAXML_SITE_PARALLEL_MIN_PATTERNS)
+  {
+    LOG_WARN << "WARNING: Enough alignment patterns for site-parallel computations (" <<
+        patterns_per_thread << " per thread), task-parallel CLV updates will be disabled." <<
+        endl << endl;
+    clv_task_threads = 1;
+  }
+}
+
+/* parallel SPR rounds: with only a few alignment patterns per thread, site-parallel likelihood
+ * computations are dominated by synchronization, so threads rather evaluate different SPR
+ * candidates on the whole alignment */
+void choose_spr_mode(RaxmlInstance& instance)
+{
+  auto& opts = instance.opts;
+  const size_t group_threads = ParallelContext::group_size();
+
+  /* NB: tree copies are synchronized via shared memory only */
+  const bool candidates_ok = group_threads > 1 && ParallelContext::num_ranks() == 1 &&
+      opts.clv_task_threads == 1 && opts.brlen_linkage != PLLMOD_TREE_BRLEN_UNLINKED;
+
+  if (opts.spr_mode == SprMode::automatic)
+  {
+    opts.spr_mode = candidates_ok && instance.parted_msa.total_length() / group_threads <
+        RAXML_SITE_PARALLEL_MIN_PATTERNS ? SprMode::candidates : SprMode::sites;
+  }
+  else if (opts.spr_mode == SprMode::candidates && !candidates_ok)
+  {
+    if (group_threads > 1)
+    {
+      LOG_WARN << "WARNING: Candidate-parallel SPR rounds are only supported with a single " <<
+          "MPI rank, falling back to site-parallel SPR rounds." << endl << endl;
+    }
+    opts.spr_mode = SprMode::sites;
+  }
+
+  if (opts.spr_mode == SprMode::candidates)
+  {
+    LOG_INFO_TS << "Parallel SPR rounds: " << group_threads << " threads per worker evaluate " <<
+        "different SPR candidates (" << instance.parted_msa.total_length() << " patterns)" <<
+        endl << endl;
+  }
+
+  SprCandidateSearch::init_groups(opts.spr_mode == SprMode::candidates ?
+                                  ParallelContext::num_groups() : 0);
+}
+
+/* init list of partition sizes, weighted by the estimated per-site cost */
+void init_part_sizes(RaxmlInstance& instance)
+{
+  PartitionAssignment& part_sizes = instance.part_sizes;
 
-  /* init list of partition sizes */
   size_t i = 0;
   for (auto const& pinfo: instance.parted_msa.part_list())
   {
-    part_sizes.assign_sites(i, 0, pinfo.msa().length());
+    part_sizes.assign_sites(i, 0, pinfo.msa().length(), pinfo.site_cost(instance.opts));
     ++i;
   }
+}
+
+void balance_load(RaxmlInstance& instance)
+{
+  PartitionAssignment& part_sizes = instance.part_sizes;
+
+  init_part_sizes(instance);
+
+  auto balancer = LoadBalancer::create(instance.opts.load_balancer);
+
+  const size_t team_size = instance.opts.clv_task_threads;
+  const size_t num_slices = ParallelContext::group_size() / team_size;
+
+  if (instance.opts.spr_mode == SprMode::candidates)
+  {
+    /* candidate-parallel SPR rounds: every thread holds the whole alignment */
+    instance.group_part_assign.assign(1, PartitionAssignmentList(ParallelContext::group_size(),
+                                                                 part_sizes));
+    LOG_INFO_TS << "Data distribution: whole alignment per thread" << endl;
+    return;
+  }
+
+  /* NB: every worker group gets the same data distribution, unless thread speeds differ */
+  const size_t num_groups = instance.thread_speeds.empty() ? 1 : ParallelContext::num_groups();
+  instance.group_part_assign.clear();
+  for (size_t g = 0; g < num_groups; ++g)
+  {
+    const auto capacities = slice_capacities(instance, g);
+    balancer->capacities(capacities);
+    auto slices = balancer->get_all_assignments(part_sizes, num_slices);
+
+    if (g == 0)
+    {
+      LOG_INFO_TS << "Data distribution: " << PartitionAssignmentStats(slices);
+      if (team_size > 1)
+        LOG_INFO << ", " << team_size << " threads per slice";
+      if (!capacities.empty())
+        LOG_INFO << ", est. imbalance: " << FMT_PREC3(estimated_imbalance(slices, capacities));
+      LOG_INFO << endl;
+    }
+    LOG_VERB << endl << slices;
+
+    instance.group_part_assign.emplace_back(expand_teams(move(slices), team_size));
+  }
+
+  if (use_bs_queue(instance.opts))
+  {
+    /* every rank infers whole bootstrap trees using its own threads only */
+    balancer->capacities(doubleVector());
+    auto slices = balancer->get_all_assignments(part_sizes,
+                                                ParallelContext::num_threads() / team_size);
+
+    LOG_VERB_TS << "Data distribution for bootstrapping (per rank): " <<
+        PartitionAssignmentStats(slices) << endl;
+
+    instance.rank_part_assign = expand_teams(move(slices), team_size);
+  }
+}
+
+/* --balance-only: data distribution for a range of processor counts (threads within a rank
+ * first, then whole ranks), e.g. to choose the job size before submitting to a cluster */
+void plan_load_balance(RaxmlInstance& instance)
+{
+  const auto& opts = instance.opts;
+  const size_t team_size = opts.clv_task_threads;
+  const size_t num_threads = opts.num_threads;
+  const size_t num_ranks = opts.num_ranks;
+
+  init_part_sizes(instance);
+
+  /* (ranks, threads per rank) */
+  vector<pair<size_t, size_t>> configs;
+  for (size_t t = team_size; t < num_threads; t *= 2)
+    configs.emplace_back(1, t);
+  for (size_t r = 1; r < num_ranks; r *= 2)
+    configs.emplace_back(r, num_threads);
+  configs.emplace_back(num_ranks, num_threads);
+
+  auto balancer = LoadBalancer::create(opts.load_balancer);
+
+  LOG_INFO << "Data distribution (" << load_balancer_name(opts.load_balancer) <<
+      " load balancer";
+  if (team_size > 1)
+    LOG_INFO << ", " << team_size << " threads per slice";
+  LOG_INFO << "):" << endl << endl;
+
+  LOG_INFO << setw(8) << "procs" << setw(8) << "ranks" << setw(8) << "threads" <<
+      setw(14) << "slices/proc" << setw(18) << "patterns/proc" << setw(12) << "imbalance" <<
+      endl;
+
+  ofstream fs_stats, fs_assign;
+  if (ParallelContext::master_rank())
+  {
+    fs_stats.open(opts.load_balance_file());
+    fs_assign.open(opts.part_assign_file());
+
+    fs_stats << "procs\tranks\tthreads\tmin_slices\tmax_slices\tmin_patterns\t" <<
+        "max_patterns\tmin_cost\tmax_cost\timbalance" << endl;
+    fs_assign << "procs\tproc\trank\tthread\tpart\tstart\tlength\tcost" << endl;
+  }
+
+  for (auto const& config: configs)
+  {
+    const size_t num_procs = config.first * config.second;
+    auto slices = balancer->get_all_assignments(instance.part_sizes, num_procs / team_size);
+    PartitionAssignmentStats stats(slices);
+
+    LOG_INFO << setw(8) << num_procs << setw(8) << config.first << setw(8) << config.second <<
+        setw(14) << (to_string(stats.min_thread_parts) + "-" + to_string(stats.max_thread_parts)) <<
+        setw(18) << (to_string(stats.min_thread_sites) + "-" + to_string(stats.max_thread_sites)) <<
+        setw(12) << FMT_PREC3(stats.imbalance()) << endl;
+
+    if (!ParallelContext::master_rank())
+      continue;
+
+    fs_stats << num_procs << "\t" << config.first << "\t" << config.second << "\t" <<
+        stats.min_thread_parts << "\t" << stats.max_thread_parts << "\t" <<
+        stats.min_thread_sites << "\t" << stats.max_thread_sites << "\t" <<
+        stats.min_thread_cost << "\t" << stats.max_thread_cost << "\t" <<
+        stats.imbalance() << endl;
+
+    /* NB: team members other than the leader work on the leader's slice */
+    auto proc_assign = expand_teams(move(slices), team_size);
+    for (size_t p = 0; p < proc_assign.size(); ++p)
+    {
+      for (auto const& range: proc_assign[p])
+      {
+        fs_assign << num_procs << "\t" << p << "\t" << p / config.second << "\t" <<
+            p % config.second << "\t" << range.part_id << "\t" << range.start << "\t" <<
+            range.length << "\t" << range.cost() << endl;
+      }
+    }
+  }
+
+  LOG_INFO << endl;
+
+  if (ParallelContext::master_rank())
+  {
+    LOG_INFO << "Load balance statistics saved to: " <<
+        sysutil_realpath(opts.load_balance_file()) << endl;
+    LOG_INFO << "Data distribution saved to: " <<
+        sysutil_realpath(opts.part_assign_file()) << endl << endl;
+  }
+}
+
+/* MPI: rank 0 sends every other rank only those alignment columns which are assigned to
+ * its threads, together with models, starting trees and the settings derived from the data.
+ * NB: in job queue mode, every rank needs the whole alignment for bootstrapping */
+void scatter_msa(RaxmlInstance& instance)
+{
+  const size_t rank_threads = ParallelContext::num_threads();
+  const bool send_all = use_bs_queue(instance.opts);
+
+  auto prepare_send_cb = [&instance, rank_threads, send_all](size_t rank, void * buf,
+                                                             int buf_size) -> int
+    {
+      const auto& opts = instance.opts;
+      const auto& parted_msa = instance.parted_msa;
+      const auto& full_msa = parted_msa.full_msa();
+
+      BinaryStream bs((char*) buf, buf_size);
+
+      bs << opts.use_pattern_compression << opts.use_tip_inner << opts.use_prob_msa;
+      bs << opts.num_searches;
+
+      /* column range covering all slices assigned to the threads of this rank */
+      vector<size_t> part_start(parted_msa.part_count(), 0);
+      vector<size_t> part_end(parted_msa.part_count(), 0);
+      for (size_t t = 0; t < rank_threads; ++t)
+      {
+        for (const auto& range: instance.group_part_assign.at(0).at(rank * rank_threads + t))
+        {
+          const auto p = range.part_id;
+          const bool first = part_start[p] == part_end[p];
+          part_start[p] = first ? range.start : min(part_start[p], range.start);
+          part_end[p] = max(part_end[p], range.start + range.length);
+        }
+      }
+
+      if (send_all)
+      {
+        for (size_t p = 0; p < parted_msa.part_count(); ++p)
+        {
+          part_start[p] = 0;
+          part_end[p] = parted_msa.part_info(p).msa().length();
+        }
+      }
+
+      bs << parted_msa.part_count();
+      for (size_t p = 0; p < parted_msa.part_count(); ++p)
+      {
+        const auto& pinfo = parted_msa.part_info(p);
+        const auto& model = pinfo.model();
+
+        /* NB: model I/O skips empirical frequencies/rates, but they were computed from data */
+        bs << model << model.num_submodels();
+        for (size_t i = 0; i < model.num_submodels(); ++i)
+          bs << model.base_freqs(i) << model.subst_rates(i);
+
+        bs << MSASlice(pinfo.msa(), part_start[p], part_end[p] - part_start[p]);
+      }
+
+      vector<string> labels;
+      for (size_t i = 0; i < full_msa.size(); ++i)
+        labels.push_back(full_msa.label(i));
+      bs << labels;
+
+      bs << instance.random_tree.topology();
+      bs << instance.start_trees.size();
+      for (const auto& tree: instance.start_trees)
+        bs << tree.topology();
+
+      return (int) bs.pos();
+    };
+
+  auto process_recv_cb = [&instance](void * buf, int buf_size)
+    {
+      auto& opts = instance.opts;
+      auto& parted_msa = instance.parted_msa;
 
-//  SimpleLoadBalancer balancer;
-  KassianLoadBalancer balancer;
+      BinaryStream bs((char*) buf, buf_size);
 
-  instance.proc_part_assign = balancer.get_all_assignments(part_sizes, ParallelContext::num_procs());
+      bs >> opts.use_pattern_compression >> opts.use_tip_inner >> opts.use_prob_msa;
+      bs >> opts.num_searches;
 
-  LOG_INFO_TS << "Data distribution: " << PartitionAssignmentStats(instance.proc_part_assign) << endl;
-  LOG_VERB << endl << instance.proc_part_assign;
+      if (bs.get<size_t>() != parted_msa.part_count())
+        throw runtime_error("Number of partitions differs between MPI ranks!");
+
+      for (size_t p = 0; p < parted_msa.part_count(); ++p)
+      {
+        Model model(parted_msa.model(p));
+        bs >> model;
+        const auto num_submodels = bs.get<unsigned int>();
+        for (size_t i = 0; i < num_submodels; ++i)
+        {
+          model.base_freqs(i, bs.get<doubleVector>());
+          model.subst_rates(i, bs.get<doubleVector>());
+        }
+        parted_msa.model(p, move(model));
+
+        MSA msa;
+        bs >> msa;
+        parted_msa.part_msa(p, move(msa));
+      }
+
+      auto labels = bs.get<vector<string>>();
+      vector<const char *> label_ptrs;
+      for (const auto& l: labels)
+        label_ptrs.push_back(l.c_str());
+
+      /* NB: topology refers to node ids, so any tree with the same tip labels will do */
+      instance.random_tree = Tree::buildRandom(labels.size(), label_ptrs.data());
+      instance.random_tree.topology(bs.get<TreeTopology>());
+
+      const auto num_start_trees = bs.get<size_t>();
+      for (size_t i = 0; i < num_start_trees; ++i)
+      {
+        Tree tree = instance.random_tree;
+        tree.topology(bs.get<TreeTopology>());
+        instance.start_trees.emplace_back(move(tree));
+      }
+    };
+
+  ParallelContext::mpi_scatter_custom(prepare_send_cb, process_recv_cb);
+}
+
+void plan_parallelization(RaxmlInstance& instance, CheckpointManager& cm)
+{
+  auto& opts = instance.opts;
+
+  /* number of workers was set by the user */
+  if (opts.num_workers > 0)
+    return;
+
+  opts.num_workers = 1;
+
+  /* coarse-grained parallelization is only implemented for threads */
+  if (ParallelContext::num_ranks() > 1 || opts.num_threads < 2)
+    return;
+
+  const auto& checkp = cm.checkpoint();
+  size_t num_jobs = 0;
+  if (opts.command == Command::search || opts.command == Command::all ||
+      opts.command == Command::evaluate)
+    num_jobs += instance.start_trees.size();
+  if (opts.num_bootstraps > checkp.bs_trees.size())
+    num_jobs += opts.num_bootstraps - checkp.bs_trees.size();
+
+  CalibrationCache cache;
+  if (!cache.load())
+  {
+    LOG_INFO_TS << "Running calibration for parallelization planner..." << endl;
+  }
+
+  ParallelPlanner planner(opts, cache);
+  auto plan = planner.plan(instance.parted_msa, num_jobs);
+
+  if (cache.modified() && !cache.save())
+    LOG_DEBUG << "Failed to write calibration data to: " << cache.fname() << endl;
+
+  LOG_VERB << endl << "Parallelization plans (workers x threads, est. time per "
+      "LH evaluation, est. relative runtime):" << endl;
+  for (const auto& p: planner.candidates())
+  {
+    LOG_VERB << "   " << p.num_groups << " x " << p.group_size << ": " <<
+        FMT_PREC3(p.eval_usec) << " us, " << FMT_PREC3(p.makespan / 1e6) << endl;
+  }
+  LOG_VERB << endl;
+
+  LOG_INFO_TS << "Parallelization plan: " << plan.num_groups << " worker(s) x " <<
+      plan.group_size << " thread(s) (" << num_jobs << " tree searches, " <<
+      "est. time per LH evaluation: " << FMT_PREC3(plan.eval_usec) << " us, " <<
+      "memory per worker: " << plan.mem_per_group / (1024 * 1024) << " MB of " <<
+      sysutil_get_memtotal() / (1024 * 1024) << " MB)" << endl;
+
+  opts.num_workers = plan.num_groups;
+  ParallelContext::init_thread_groups(plan.num_groups, opts.barrier_mode);
 }
 
 void generate_bootstraps(RaxmlInstance& instance, const Checkpoint& checkp)
 {
   if (instance.opts.command == Command::bootstrap || instance.opts.command == Command::all)
   {
+    /* NB: ranks which received the alignment from rank 0 skipped some calls to rand(),
+     * so replicate seeds must come from rank 0 to be identical everywhere */
+    vector<unsigned long> seeds(instance.opts.num_bootstraps);
+    for (auto& seed: seeds)
+      seed = rand();
+    ParallelContext::mpi_broadcast(seeds.data(), seeds.size() * sizeof(unsigned long));
+
+    /* NB: replicates might have been finished out of order (worker groups, MPI job queue) */
+    const set<size_t> ckp_bs_nums(checkp.bs_nums.cbegin(), checkp.bs_nums.cend());
+
     BootstrapGenerator bg;
     for (size_t b = 0; b < instance.opts.num_bootstraps; ++b)
     {
-      auto seed = rand();
-
       /* check if this BS was already computed in the previous run and saved in checkpoint */
-      if (b < checkp.bs_trees.size())
+      if (ckp_bs_nums.count(b + 1))
         continue;
 
-      instance.bs_reps.emplace_back(bg.generate(instance.parted_msa, seed));
+      instance.bs_reps.emplace_back(bg.generate(instance.parted_msa, seeds[b]));
+      instance.bs_nums.push_back(b + 1);
     }
   }
 }
@@ -528,6 +1031,12 @@ void print_final_output(const RaxmlInstance& instance, const Checkpoint& checkp)
       LOG_INFO << "All ML trees saved to: " << sysutil_realpath(opts.ml_trees_file()) << endl;
     }
 
+    if (checkp.culled_trees > 0)
+    {
+      LOG_INFO << "NOTE: " << checkp.culled_trees << " starting tree(s) culled by racing "
+          "are not included in the ML trees" << endl;
+    }
+
     LOG_INFO << "Best ML tree saved to: " << sysutil_realpath(opts.best_tree_file()) << endl;
 
     if (opts.command == Command::all)
@@ -544,15 +1053,20 @@ void print_final_output(const RaxmlInstance& instance, const Checkpoint& checkp)
 
   if (opts.command == Command::bootstrap || opts.command == Command::all)
   {
-    // TODO now only master process writes the output, this will have to change with
-    // coarse-grained parallelization scheme (parallel start trees/bootstraps)
-//    NewickStream nw(opts.bootstrap_trees_file(), std::ios::out | std::ios::app);
+    /* NB: bootstrap trees of all worker groups and ranks are collected in the master's
+     * checkpoint in order of completion (see CheckpointManager::save_bs_tree()) */
     NewickStream nw(opts.bootstrap_trees_file(), std::ios::out);
 
+    const auto& bs_nums = checkp.bs_nums;
+    vector<size_t> order(bs_nums.size());
+    iota(order.begin(), order.end(), 0);
+    stable_sort(order.begin(), order.end(),
+                [&bs_nums](size_t a, size_t b) { return bs_nums[a] < bs_nums[b]; });
+
     Tree bs_tree = checkp.tree;
-    for (auto topol: checkp.bs_trees)
+    for (auto i: order)
     {
-      bs_tree.topology(topol.second);
+      bs_tree.topology((checkp.bs_trees.begin() + i)->second);
       nw << bs_tree;
     }
 
@@ -570,25 +1084,372 @@ void print_final_output(const RaxmlInstance& instance, const Checkpoint& checkp)
   LOG_INFO << endl;
 }
 
-void thread_main(const RaxmlInstance& instance, CheckpointManager& cm)
+/* racing multi-start search (see --race): only if there is something to cull and no interrupted
+ * search to resume (NB: states are collected in shared memory, so a single rank only) */
+bool use_race(const RaxmlInstance& instance, CheckpointManager& cm)
+{
+  const auto& opts = instance.opts;
+  return opts.race_lh_diff != 0. && ParallelContext::num_ranks() == 1 &&
+      (opts.command == Command::search || opts.command == Command::all) &&
+      instance.start_trees.size() > opts.race_keep &&
+      cm.checkpoint().search_state.step == CheckpointStep::start;
+}
+
+/* racing: keep the starting trees which might still catch up with the best one */
+void cull_start_trees(const RaxmlInstance& instance, RaceState& race)
+{
+  const auto& opts = instance.opts;
+  const auto& states = race.states;
+  const size_t n = states.size();
+
+  double mean = 0.;
+  for (auto const& state: states)
+    mean += state.loglh() / n;
+
+  double var = 0.;
+  for (auto const& state: states)
+    var += (state.loglh() - mean) * (state.loglh() - mean) / (n - 1);
+
+  /* auto: logLH spread among the starting trees */
+  const double lh_diff = opts.race_lh_diff > 0. ? opts.race_lh_diff :
+                                                  RAXML_RACE_AUTO_SD * sqrt(var);
+
+  vector<size_t> order(n);
+  iota(order.begin(), order.end(), 0);
+  stable_sort(order.begin(), order.end(),
+              [&states](size_t a, size_t b) { return states[a].loglh() > states[b].loglh(); });
+
+  const double best_loglh = states[order[0]].loglh();
+  auto& survivors = race.survivors;
+  survivors.clear();
+  for (size_t k = 0; k < n; ++k)
+  {
+    const size_t i = order[k];
+    if (k < opts.race_keep || best_loglh - states[i].loglh() <= lh_diff)
+      survivors.push_back(i);
+  }
+  sort(survivors.begin(), survivors.end());
+
+  LOG_INFO << endl;
+  LOG_INFO_TS << "Racing: " << survivors.size() << " out of " << n << " starting trees within " <<
+      FMT_PREC3(lh_diff) << " logLH units of the best one (" << FMT_LH(best_loglh) <<
+      "), culled: " << n - survivors.size() << endl << endl;
+}
+
+/* racing: estimate compute time saved by culling, assuming culled trees would have needed
+ * as much time after the FAST SPR phase as the finished ones on average */
+void log_race_savings(const RaceState& race)
+{
+  const auto& survivors = race.survivors;
+  const size_t culled = race.states.size() - survivors.size();
+
+  double fast_time = 0.;
+  for (auto t: race.fast_times)
+    fast_time += t;
+
+  double slow_time = 0.;
+  for (auto i: survivors)
+    slow_time += race.slow_times[i];
+
+  const double saved = culled * slow_time / survivors.size();
+  const double total = fast_time + slow_time + saved;
+  const double saved_pct = total > 0. ? 100. * saved / total : 0.;
+
+  LOG_INFO_TS << "Racing: culled " << culled << " starting trees, estimated time saved: " <<
+      FMT_PREC3(saved) << " worker-seconds (" << FMT_PREC3(saved_pct) << "% of the ML search)" <<
+      endl;
+}
+
+size_t next_job(atomic<size_t>& job_counter)
+{
+  /* group master takes the next job from the shared counter and passes it to the
+   * other threads of its group */
+  size_t job_id = 0;
+  if (ParallelContext::group_master_thread())
+  {
+    /* MPI job queue: counter is shared by all ranks */
+    job_id = ParallelContext::mpi_job_queue() ? ParallelContext::mpi_next_job() : job_counter++;
+  }
+
+  ParallelContext::thread_broadcast(0, &job_id, sizeof(size_t));
+
+  return job_id;
+}
+
+string worker_str()
+{
+  return ParallelContext::num_groups() > 1 ?
+      " (worker #" + to_string(ParallelContext::group_id() + 1) + ")" : "";
+}
+
+/* runtime load balancing is done within a group of threads sharing the whole alignment
+ * (NB: with multiple MPI ranks, every rank only holds the columns assigned to its threads) */
+bool use_rebalance(const Options& opts)
+{
+  return opts.rebalance_threshold > 0. && opts.spr_mode != SprMode::candidates &&
+      ParallelContext::group_ranks() == 1 &&
+      ParallelContext::group_size() / opts.clv_task_threads > 1;
+}
+
+/* runtime load balancing: compare the computation times measured since the last call and
+ * re-distribute the data among the threads of the current group if the imbalance exceeds the
+ * threshold. Must be called by all threads of a group right after update_and_write().
+ * NB: every thread keeps its own copy of the data distribution and computes the same result */
+void rebalance_load(const RaxmlInstance& instance, PartitionAssignment& part_sizes,
+                    PartitionAssignmentList& part_assign, TreeInfo& treeinfo,
+                    const Checkpoint& ckp, const vector<uintVector>& site_weights)
+{
+  const auto& opts = instance.opts;
+  const size_t team_size = opts.clv_task_threads;
+  const auto capacities = slice_capacities(instance, ParallelContext::group_id());
+
+  /* collect work times of all threads; a team spends the same time as its leader */
+  doubleVector thread_times(ParallelContext::group_size(), 0.);
+  thread_times[ParallelContext::local_proc_id()] = ParallelContext::work_time();
+  ParallelContext::thread_reduce(thread_times.data(), thread_times.size(),
+                                 PLLMOD_TREE_REDUCE_SUM);
+
+  PartitionAssignmentList slices;
+  doubleVector slice_times;
+  double max_time = 0., total_time = 0.;
+  for (size_t i = 0; i < part_assign.size(); i += team_size)
+  {
+    slices.push_back(part_assign[i]);
+    slice_times.push_back(thread_times[i]);
+    max_time = max(max_time, thread_times[i]);
+    total_time += thread_times[i];
+  }
+
+  /* start next measurement interval */
+  ParallelContext::work_timer_start();
+
+  if (!(total_time > 0.))
+    return;
+
+  const double imbalance = max_time * slices.size() / total_time;
+
+  {
+    ParallelContext::UniqueLock lock;
+    LOG_DEBUG << "Measured thread times (sec):";
+    for (auto t: slice_times)
+      LOG_DEBUG << " " << t;
+    LOG_DEBUG << endl;
+  }
+
+  if (imbalance < opts.rebalance_threshold)
+    return;
+
+  auto new_sizes = calibrate_site_costs(part_sizes, slices, slice_times, capacities);
+
+  auto balancer = LoadBalancer::create(opts.load_balancer);
+  balancer->capacities(capacities);
+  auto new_slices = balancer->get_all_assignments(new_sizes, slices.size());
+  PartitionAssignmentStats new_stats(new_slices);
+  const double new_imbalance = estimated_imbalance(new_slices, capacities);
+
+  /* new distribution is not expected to be any better -> keep the old one */
+  if (new_imbalance >= imbalance)
+    return;
+
+  {
+    ParallelContext::UniqueLock lock;
+    LOG_WORKER_TS(LogLevel::info) << "Load imbalance: " << FMT_PREC3(imbalance) <<
+        " (measured) -> " << FMT_PREC3(new_imbalance) << " (estimated), " <<
+        "re-distributing data" << worker_str() << endl;
+    LOG_WORKER_TS(LogLevel::verbose) << "New data distribution: " << new_stats << endl;
+  }
+
+  part_sizes = move(new_sizes);
+  part_assign = expand_teams(move(new_slices), team_size);
+
+  /* re-create partitions, keeping the current tree and model parameters */
+  const auto& my_assign = part_assign.at(ParallelContext::local_proc_id());
+  TreeInfo new_treeinfo(opts, treeinfo.tree(), instance.parted_msa, my_assign, site_weights);
+  for (auto const& m: ckp.models)
+  {
+    if (new_treeinfo.pll_treeinfo().partitions[m.first])
+      new_treeinfo.model(m.first, m.second);
+  }
+
+  treeinfo = move(new_treeinfo);
+
+  /* NB: partition setup time doesn't count */
+  ParallelContext::thread_barrier();
+  ParallelContext::work_timer_start();
+}
+
+void save_race_state(Checkpoint& state, const Checkpoint& ckp)
+{
+  state.search_state = ckp.search_state;
+  state.tree = ckp.tree;
+  state.models = ckp.models;
+}
+
+/* racing multi-start search: stage 1 runs all starting trees up to the end of the FAST SPR
+ * phase, stage 2 resumes those within reach of the best one (see cull_start_trees()) */
+void race_ml_search(const RaxmlInstance& instance, RaceState& race, CheckpointManager& cm,
+                    PartitionAssignment& part_sizes, PartitionAssignmentList& part_assign,
+                    bool rebalance)
+{
+  auto const& opts = instance.opts;
+  auto& states = race.states;
+  const size_t ckp_ml_trees = cm.checkpoint().ml_trees.size() + cm.checkpoint().culled_trees;
+  unique_ptr<TreeInfo> treeinfo;
+
+  Optimizer optimizer(opts);
+  if (rebalance)
+  {
+    optimizer.rebalance_cb([&instance, &part_sizes, &part_assign, &cm](TreeInfo& ti)
+      {
+        rebalance_load(instance, part_sizes, part_assign, ti, cm.group_checkpoint(),
+                       vector<uintVector>());
+      });
+  }
+
+  optimizer.stop_step(CheckpointStep::modOpt3);
+  for (size_t i = next_job(instance.next_start_tree); i < states.size();
+      i = next_job(instance.next_start_tree))
+  {
+    const double start_time = sysutil_elapsed_seconds();
+    auto const& my_assign = part_assign.at(ParallelContext::local_proc_id());
+    treeinfo.reset(new TreeInfo(opts, instance.start_trees.at(i), instance.parted_msa, my_assign));
+
+    optimizer.optimize_topology(*treeinfo, cm);
+
+    /* NB: every starting tree is processed by exactly one worker group */
+    if (ParallelContext::group_master_thread())
+    {
+      save_race_state(states[i], cm.group_checkpoint());
+      race.fast_times[i] = sysutil_elapsed_seconds() - start_time;
+    }
+
+    {
+      ParallelContext::UniqueLock lock;
+
+      LOG_PROGR << endl;
+      LOG_WORKER_TS(LogLevel::info) << "ML tree search #" << ckp_ml_trees + i + 1 <<
+          ", logLikelihood after FAST SPRs: " << FMT_LH(cm.group_checkpoint().loglh()) <<
+          worker_str() << endl;
+      LOG_PROGR << endl;
+    }
+
+    cm.reset_search_state();
+  }
+
+  ParallelContext::global_thread_barrier();
+
+  if (ParallelContext::master_thread())
+    cull_start_trees(instance, race);
+
+  ParallelContext::global_thread_barrier();
+
+  optimizer.stop_step(CheckpointStep::finish);
+  const auto& survivors = race.survivors;
+  for (size_t k = next_job(race.next_tree); k < survivors.size();
+      k = next_job(race.next_tree))
+  {
+    const size_t i = survivors[k];
+    auto& state = states[i];
+    const double start_time = sysutil_elapsed_seconds();
+
+    auto const& my_assign = part_assign.at(ParallelContext::local_proc_id());
+    treeinfo.reset(new TreeInfo(opts, state.tree, instance.parted_msa, my_assign));
+    for (auto const& m: state.models)
+    {
+      if (treeinfo->pll_treeinfo().partitions[m.first])
+        treeinfo->model(m.first, m.second);
+    }
+
+    /* resume right after the FAST SPR phase */
+    if (ParallelContext::group_master_thread())
+      cm.search_state() = state.search_state;
+    ParallelContext::thread_barrier();
+
+    optimizer.optimize_topology(*treeinfo, cm);
+
+    if (ParallelContext::group_master_thread())
+    {
+      save_race_state(state, cm.group_checkpoint());
+      race.slow_times[i] = sysutil_elapsed_seconds() - start_time;
+    }
+
+    {
+      ParallelContext::UniqueLock lock;
+
+      LOG_PROGR << endl;
+      LOG_WORKER_TS(LogLevel::info) << "ML tree search #" << ckp_ml_trees + i + 1 <<
+          ", logLikelihood: " << FMT_LH(cm.group_checkpoint().loglh()) << worker_str() << endl;
+      LOG_PROGR << endl;
+    }
+
+    cm.reset_search_state();
+  }
+
+  ParallelContext::global_thread_barrier();
+
+  /* NB: the race state is not checkpointed, so an interrupted race will be restarted from
+   * scratch. Once finished, the surviving trees are saved in their original order. Culled trees
+   * are only half-optimized, so they are left out of the ML trees and just counted in the
+   * checkpoint, so that a resumed run will not search any of them again */
+  if (ParallelContext::master_thread())
+  {
+    for (auto i: survivors)
+      cm.save_ml_tree(states[i]);
+
+    cm.save_culled_trees(states.size() - survivors.size());
+
+    cm.defer_write(false);
+    cm.write();
+
+    if (survivors.size() < states.size())
+    {
+      LOG_INFO_TS << "Racing: culled starting trees (not included in the ML trees):";
+      for (size_t i = 0, k = 0; i < states.size(); ++i)
+      {
+        if (k < survivors.size() && survivors[k] == i)
+          ++k;
+        else
+          LOG_INFO << " #" << ckp_ml_trees + i + 1;
+      }
+      LOG_INFO << endl;
+    }
+
+    log_race_savings(race);
+  }
+
+  ParallelContext::global_thread_barrier();
+}
+
+void thread_main(const RaxmlInstance& instance, RaceState& race, CheckpointManager& cm)
 {
   unique_ptr<TreeInfo> treeinfo;
 
 //  printf("thread %lu / %lu\n", ParallelContext::thread_id(), ParallelContext::num_procs());
 
   /* wait until master thread prepares all global data */
-  ParallelContext::thread_barrier();
+  ParallelContext::global_thread_barrier();
+
+  /* worker groups might have been re-configured by the planner */
+  ParallelContext::update_thread_group();
 
   auto const& master_msa = instance.parted_msa;
   auto const& opts = instance.opts;
 
-  /* get partitions assigned to the current thread */
-  auto const& part_assign = instance.proc_part_assign.at(ParallelContext::proc_id());
+  /* data distribution within the current group: can be changed by runtime load balancing,
+   * so every thread keeps its own copy (see rebalance_load()) */
+  PartitionAssignment part_sizes = instance.part_sizes;
+  PartitionAssignmentList part_assign = group_part_assign(instance);
+  bool rebalance = use_rebalance(opts);
 
-  if ((opts.command == Command::search || opts.command == Command::all ||
-      opts.command == Command::evaluate ) && !instance.start_trees.empty())
-  {
+  const size_t ckp_ml_trees = cm.checkpoint().ml_trees.size() + cm.checkpoint().culled_trees;
+  const size_t ckp_bs_trees = cm.checkpoint().bs_trees.size();
+  bool use_ckp_tree = cm.checkpoint().search_state.step != CheckpointStep::start;
 
+  const bool do_ml_search = (opts.command == Command::search || opts.command == Command::all ||
+      opts.command == Command::evaluate ) && !instance.start_trees.empty();
+
+  if (do_ml_search)
+  {
     if (opts.command == Command::evaluate)
     {
       LOG_INFO << "\nEvaluating " << opts.num_searches <<
@@ -599,22 +1460,33 @@ void thread_main(const RaxmlInstance& instance, CheckpointManager& cm)
       LOG_INFO << "\nStarting ML tree search with " << opts.num_searches <<
           " distinct starting trees" << endl << endl;
     }
+  }
 
-    size_t start_tree_num = cm.checkpoint().ml_trees.size();
-    bool use_ckp_tree = cm.checkpoint().search_state.step != CheckpointStep::start;
-    for (const auto& tree: instance.start_trees)
+  /* make sure all threads have read the checkpoint before workers start updating it */
+  ParallelContext::global_thread_barrier();
+
+  if (do_ml_search && race.active())
+    race_ml_search(instance, race, cm, part_sizes, part_assign, rebalance);
+  else if (do_ml_search)
+  {
+    for (size_t i = next_job(instance.next_start_tree); i < instance.start_trees.size();
+        i = next_job(instance.next_start_tree))
     {
+      const auto& tree = instance.start_trees.at(i);
       assert(!tree.empty());
 
-      start_tree_num++;
+      const size_t start_tree_num = ckp_ml_trees + i + 1;
+
+      /* get partitions assigned to the current thread */
+      auto const& my_assign = part_assign.at(ParallelContext::local_proc_id());
 
       if (use_ckp_tree)
       {
-        treeinfo.reset(new TreeInfo(opts, cm.checkpoint().tree, master_msa, part_assign));
+        treeinfo.reset(new TreeInfo(opts, cm.checkpoint().tree, master_msa, my_assign));
         use_ckp_tree = false;
       }
       else
-        treeinfo.reset(new TreeInfo(opts, tree, master_msa, part_assign));
+        treeinfo.reset(new TreeInfo(opts, tree, master_msa, my_assign));
 
   //    if (!treeinfo)
   //      treeinfo.reset(new TreeInfo(opts, tree, master_msa, part_assign));
@@ -622,10 +1494,22 @@ void thread_main(const RaxmlInstance& instance, CheckpointManager& cm)
   //      treeinfo->tree(tree);
 
       Optimizer optimizer(opts);
+      if (rebalance)
+      {
+        optimizer.rebalance_cb([&instance, &part_sizes, &part_assign, &cm](TreeInfo& ti)
+          {
+            rebalance_load(instance, part_sizes, part_assign, ti, cm.group_checkpoint(),
+                           vector<uintVector>());
+          });
+      }
       if (opts.command == Command::evaluate)
       {
-        LOG_INFO_TS << "Tree #" << start_tree_num <<
-            ", initial LogLikelihood: " << FMT_LH(treeinfo->loglh()) << endl;
+        double loglh = treeinfo->loglh();
+        {
+          ParallelContext::UniqueLock lock;
+          LOG_WORKER_TS(LogLevel::info) << "Tree #" << start_tree_num <<
+              ", initial LogLikelihood: " << FMT_LH(loglh) << worker_str() << endl;
+        }
         cm.search_state().loglh = optimizer.optimize(*treeinfo);
         cm.update_and_write(*treeinfo);
       }
@@ -634,25 +1518,31 @@ void thread_main(const RaxmlInstance& instance, CheckpointManager& cm)
         optimizer.optimize_topology(*treeinfo, cm);
       }
 
-      LOG_PROGR << endl;
-      if (opts.command == Command::evaluate)
-      {
-        LOG_INFO_TS << "Tree #" << start_tree_num <<
-            ", final logLikelihood: " << FMT_LH(cm.checkpoint().loglh()) << endl;
-      }
-      else
       {
-        LOG_INFO_TS << "ML tree search #" << start_tree_num <<
-            ", logLikelihood: " << FMT_LH(cm.checkpoint().loglh()) << endl;
+        ParallelContext::UniqueLock lock;
+
+        LOG_PROGR << endl;
+        if (opts.command == Command::evaluate)
+        {
+          LOG_WORKER_TS(LogLevel::info) << "Tree #" << start_tree_num <<
+              ", final logLikelihood: " << FMT_LH(cm.group_checkpoint().loglh()) <<
+              worker_str() << endl;
+        }
+        else
+        {
+          LOG_WORKER_TS(LogLevel::info) << "ML tree search #" << start_tree_num <<
+              ", logLikelihood: " << FMT_LH(cm.group_checkpoint().loglh()) <<
+              worker_str() << endl;
+        }
+        LOG_PROGR << endl;
       }
-      LOG_PROGR << endl;
 
       cm.save_ml_tree();
       cm.reset_search_state();
     }
   }
 
-  ParallelContext::thread_barrier();
+  ParallelContext::global_thread_barrier();
 
   if (!instance.bs_reps.empty())
   {
@@ -667,49 +1557,108 @@ void thread_main(const RaxmlInstance& instance, CheckpointManager& cm)
              << " replicates." << endl << endl;
   }
 
+  /* MPI job queue: from now on, ranks work independently of each other */
+  const bool bs_queue = use_bs_queue(opts) && !instance.bs_reps.empty();
+  if (bs_queue)
+  {
+    if (ParallelContext::master_thread())
+      ParallelContext::mpi_job_queue_begin();
+
+    ParallelContext::global_thread_barrier();
+  }
+
+  /* NB: site weights differ between replicates, so start from the static distribution again */
+  part_sizes = instance.part_sizes;
+  part_assign = bs_queue ? instance.rank_part_assign : group_part_assign(instance);
+  rebalance = use_rebalance(opts);
+
   /* infer bootstrap trees if needed */
-  size_t bs_num = cm.checkpoint().bs_trees.size();
-  for (const auto bs: instance.bs_reps)
+  for (size_t i = next_job(instance.next_bs_rep); i < instance.bs_reps.size();
+      i = next_job(instance.next_bs_rep))
   {
-    ++bs_num;
+    const auto& bs = instance.bs_reps.at(i);
+    const size_t bs_num = instance.bs_nums.at(i);
 
 //    Tree tree = Tree::buildRandom(master_msa.full_msa());
     /* for now, use the same random tree for all bootstraps */
     const Tree& tree = instance.random_tree;
-    treeinfo.reset(new TreeInfo(opts, tree, master_msa, part_assign, bs.site_weights));
+    auto const& my_assign = part_assign.at(ParallelContext::local_proc_id());
+    treeinfo.reset(new TreeInfo(opts, tree, master_msa, my_assign, bs.site_weights));
 
     Optimizer optimizer(opts);
+    if (rebalance)
+    {
+      optimizer.rebalance_cb([&instance, &part_sizes, &part_assign, &cm, &bs](TreeInfo& ti)
+        {
+          rebalance_load(instance, part_sizes, part_assign, ti, cm.group_checkpoint(),
+                         bs.site_weights);
+        });
+    }
     optimizer.optimize_topology(*treeinfo, cm);
 
-    LOG_PROGR << endl;
-    LOG_INFO_TS << "Bootstrap tree #" << bs_num <<
-                ", logLikelihood: " << FMT_LH(cm.checkpoint().loglh()) << endl;
-    LOG_PROGR << endl;
+    {
+      ParallelContext::UniqueLock lock;
+
+      LOG_PROGR << endl;
+      LOG_WORKER_TS(LogLevel::info) << "Bootstrap tree #" << bs_num <<
+                  ", logLikelihood: " << FMT_LH(cm.group_checkpoint().loglh()) <<
+                  worker_str() << endl;
+      LOG_PROGR << endl;
+    }
 
-    cm.save_bs_tree();
+    cm.save_bs_tree(bs_num);
     cm.reset_search_state();
   }
 
-  ParallelContext::thread_barrier();
+  if (bs_queue)
+  {
+    if (ParallelContext::master_thread())
+    {
+      /* rank 0 waits for the trees which are still being inferred by other ranks */
+      if (ParallelContext::master_rank())
+      {
+        while (cm.checkpoint().bs_trees.size() < ckp_bs_trees + instance.bs_reps.size())
+          cm.collect_bs_trees(true);
+      }
+
+      ParallelContext::mpi_job_queue_end();
+    }
+  }
+
+  ParallelContext::global_thread_barrier();
 }
 
-void master_main(RaxmlInstance& instance, CheckpointManager& cm)
+void master_main(RaxmlInstance& instance, RaceState& race, CheckpointManager& cm)
 {
   auto const& opts = instance.opts;
   auto& parted_msa = instance.parted_msa;
 
   init_part_info(instance);
 
-  load_msa(instance);
+  /* MPI: only rank 0 reads the alignment, other ranks receive just the slices they need.
+   * NB: probabilistic alignments are still loaded by every rank */
+  const bool distributed_msa = ParallelContext::num_ranks() > 1 && !opts.use_prob_msa;
 
-  /* init template tree */
-  instance.random_tree = generate_tree(instance, StartingTree::random);
+  if (distributed_msa && !ParallelContext::master_rank())
+  {
+    /* receive alignment slices, models and starting trees from rank 0 */
+    scatter_msa(instance);
 
-  /* load checkpoint */
-  load_checkpoint(instance, cm);
+    load_checkpoint(instance, cm);
+  }
+  else
+  {
+    load_msa(instance);
 
-  /* load/create starting tree */
-  build_start_trees(instance, cm);
+    /* init template tree */
+    instance.random_tree = generate_tree(instance, StartingTree::random);
+
+    /* load checkpoint */
+    load_checkpoint(instance, cm);
+
+    /* load/create starting tree */
+    build_start_trees(instance, cm);
+  }
 
   LOG_VERB << endl << "Initial model parameters:" << endl;
   for (size_t p = 0; p < parted_msa.part_count(); ++p)
@@ -718,13 +1667,90 @@ void master_main(RaxmlInstance& instance, CheckpointManager& cm)
         parted_msa.model(p) << endl;
   }
 
+  /* choose number of worker groups and threads per group, if needed */
+  plan_parallelization(instance, cm);
+  cm.init_groups(ParallelContext::num_groups());
+
+  choose_clv_tasks(instance);
+  TraversalScheduler::init_teams(ParallelContext::num_threads(), instance.opts.clv_task_threads,
+                                 opts.barrier_mode);
+
+  if (!ParallelContext::thread_cpus().empty())
+  {
+    const auto& cpus = ParallelContext::thread_cpus();
+    LOG_INFO_TS << "Thread pinning: " << ParallelContext::thread_layout() << endl << endl;
+
+    if (std::set<int>(cpus.begin(), cpus.end()).size() < cpus.size())
+    {
+      LOG_WARN << "WARNING: More threads than CPUs available to this process, "
+          "some threads will share a CPU! Please consider using fewer threads or --pin none."
+          << endl << endl;
+    }
+  }
+
+  choose_spr_mode(instance);
+
   /* run load balancing algorithm */
+  calibrate_thread_speeds(instance);
   balance_load(instance);
 
+  if (distributed_msa && ParallelContext::master_rank())
+  {
+    LOG_VERB_TS << "Sending alignment slices to " << ParallelContext::num_ranks() - 1 <<
+        " MPI ranks..." << endl;
+    scatter_msa(instance);
+  }
+
+  /* pre-allocate buffers for thread/MPI collectives */
+  ParallelContext::resize_buffers(parted_msa.part_count());
+
   /* generate bootstrap replicates */
   generate_bootstraps(instance, cm.checkpoint());
 
-  thread_main(instance, cm);
+  if (use_race(instance, cm))
+  {
+    const size_t num_trees = instance.start_trees.size();
+    race.states.resize(num_trees);
+    race.fast_times.assign(num_trees, 0.);
+    race.slow_times.assign(num_trees, 0.);
+
+    /* intermediate search states of the racing trees must not end up in the checkpoint file,
+     * since they can't be attributed to a starting tree on resume (see race_ml_search()) */
+    cm.defer_write(true);
+  }
+
+  thread_main(instance, race, cm);
+
+  auto buf_stats = ParallelContext::buffer_stats();
+  LOG_DEBUG << "Collective buffers: reduce " << buf_stats.reduce_buf_peak << " / " <<
+      buf_stats.reduce_buf_size << " bytes, gather " << buf_stats.gather_buf_peak << " / " <<
+      buf_stats.gather_buf_size << " bytes (peak / allocated), " <<
+      buf_stats.resize_count << " resize(s)" << endl;
+
+  for (const auto& c: ParallelContext::reduce_counters())
+  {
+    LOG_DEBUG << "Reductions (" << c.first << "): " << c.second.calls << " requested, " <<
+        c.second.elements << " elements, " << c.second.collectives << " collectives" << endl;
+  }
+
+  LOG_DEBUG << "CLV updates skipped by cached/incremental logLH evaluation: " <<
+      TreeInfo::skipped_clv_updates() << endl;
+
+  if (opts.adaptive_modopt && ModelOptScheduler::total_steps() > 0)
+  {
+    LOG_VERB << "Adaptive model optimization: skipped " << ModelOptScheduler::skipped_steps() <<
+        " / " << ModelOptScheduler::total_steps() <<
+        " parameter optimization steps of converged partitions" << endl;
+  }
+
+  if (ParallelContext::num_ranks() > 1)
+  {
+    auto red_stats = ParallelContext::reduce_stats();
+    LOG_VERB << "MPI reductions: " << red_stats.sync_count << " blocking (" <<
+        FMT_PREC3(red_stats.sync_time) << " s), " << red_stats.async_count <<
+        " non-blocking (" << FMT_PREC3(red_stats.async_wait_time) << " s waiting, ~" <<
+        FMT_PREC3(red_stats.async_hidden_time) << " s hidden)" << endl;
+  }
 
   if (ParallelContext::master_rank())
   {
@@ -779,6 +1805,19 @@ int main(int argc, char** argv)
       print_banner();
       clean_exit(EXIT_SUCCESS);
       break;
+    case Command::benchmark:
+      print_banner();
+      try
+      {
+        run_benchmark(instance.opts);
+      }
+      catch(exception& e)
+      {
+        LOG_ERROR << endl << "ERROR: " << e.what() << endl << endl;
+        clean_exit(EXIT_FAILURE);
+      }
+      clean_exit(EXIT_SUCCESS);
+      break;
     default:
       break;
   }
@@ -820,11 +1859,43 @@ int main(int argc, char** argv)
         }
 
         CheckpointManager cm(instance.opts.checkp_file());
+        RaceState race;
         ParallelContext::init_pthreads(instance.opts, std::bind(thread_main,
                                                                 std::cref(instance),
+                                                                std::ref(race),
                                                                 std::ref(cm)));
 
-        master_main(instance, cm);
+        if (instance.opts.mpi_thread_multiple && !ParallelContext::mpi_thread_multiple() &&
+            ParallelContext::num_ranks() > 1 && ParallelContext::num_threads() > 1)
+        {
+          LOG_WARN << "WARNING: MPI library does not support MPI_THREAD_MULTIPLE, "
+              "falling back to funneled mode!" << endl << endl;
+        }
+
+        if (ParallelContext::num_ranks() > 1)
+        {
+          LOG_VERB << "MPI: " << ParallelContext::num_ranks() << " ranks on " <<
+              ParallelContext::num_nodes() << " node(s), " <<
+              (ParallelContext::mpi_hierarchical() ? "hierarchical" : "flat") <<
+              " reductions" << endl << endl;
+        }
+
+        master_main(instance, race, cm);
+      }
+      catch(exception& e)
+      {
+        LOG_ERROR << endl << "ERROR: " << e.what() << endl << endl;
+        retval = EXIT_FAILURE;
+      }
+      break;
+    }
+    case Command::balance:
+    {
+      try
+      {
+        init_part_info(instance);
+        load_msa(instance);
+        plan_load_balance(instance);
       }
       catch(exception& e)
       {
@@ -16,7 +16,9 @@ enum class Command
   evaluate,
   search,
   bootstrap,
-  all
+  all,
+  benchmark,
+  balance
 };
 
 enum class FileFormat
@@ -39,6 +41,21 @@ enum class DataType
   diploid10
 };
 
+enum class BenchmarkType
+{
+  none = 0,
+  barrier,
+  reduce
+};
+
+/* parallelization of SPR rounds within a worker group */
+enum class SprMode
+{
+  automatic = 0,
+  sites,
+  candidates
+};
+
 enum class ParamValue
 {
   undefined = 0,
@@ -115,6 +115,328 @@ TEST(CommandLineParserTest, search_complex2)
   EXPECT_DOUBLE_EQ(0.5, options.spr_cutoff);
 }
 
+TEST(CommandLineParserTest, search_barrier)
+{
+  // buildup
+  CommandLineParser parser;
+  Options options;
+
+  // default: adaptive thread barrier
+  string cmd = "raxml-ng --msa data.fa --model GTR";
+  parse_options(cmd, parser, options, false);
+  EXPECT_EQ(BarrierMode::adaptive, options.barrier_mode);
+
+  cmd = "raxml-ng --msa data.fa --model GTR --threads 4 --barrier spin";
+  parse_options(cmd, parser, options, false);
+  EXPECT_EQ(BarrierMode::spin, options.barrier_mode);
+
+  // wrong: unknown barrier mode
+  cmd = "raxml-ng --msa data.fa --model GTR --barrier fast";
+  parse_options(cmd, parser, options, true);
+}
+
+TEST(CommandLineParserTest, search_workers)
+{
+  // buildup
+  CommandLineParser parser;
+  Options options;
+
+  string cmd = "raxml-ng --msa data.fa --model GTR --threads 8 --workers 4";
+  parse_options(cmd, parser, options, false);
+  EXPECT_EQ(8, options.num_threads);
+  EXPECT_EQ(4, options.num_workers);
+
+  // wrong: #threads is not a multiple of #workers
+  cmd = "raxml-ng --msa data.fa --model GTR --threads 6 --workers 4";
+  parse_options(cmd, parser, options, true);
+
+  // wrong: zero workers
+  cmd = "raxml-ng --msa data.fa --model GTR --workers 0";
+  parse_options(cmd, parser, options, true);
+}
+
+TEST(CommandLineParserTest, search_spr_mode)
+{
+  // buildup
+  CommandLineParser parser;
+  Options options;
+
+  // default: choose automatically
+  string cmd = "raxml-ng --msa data.fa --model GTR";
+  parse_options(cmd, parser, options, false);
+  EXPECT_EQ(SprMode::automatic, options.spr_mode);
+
+  cmd = "raxml-ng --msa data.fa --model GTR --threads 4 --spr-mode candidates";
+  parse_options(cmd, parser, options, false);
+  EXPECT_EQ(SprMode::candidates, options.spr_mode);
+
+  // wrong: threads evaluating different candidates can not share data slices
+  cmd = "raxml-ng --msa data.fa --model GTR --threads 4 --clv-tasks 2 --spr-mode candidates";
+  parse_options(cmd, parser, options, true);
+
+  // wrong: unknown mode
+  cmd = "raxml-ng --msa data.fa --model GTR --spr-mode moves";
+  parse_options(cmd, parser, options, true);
+}
+
+TEST(CommandLineParserTest, search_race)
+{
+  // buildup
+  CommandLineParser parser;
+  Options options;
+
+  // default: finish all starting trees
+  string cmd = "raxml-ng --msa data.fa --model GTR --tree pars{50}";
+  parse_options(cmd, parser, options, false);
+  EXPECT_EQ(0., options.race_lh_diff);
+
+  cmd = "raxml-ng --msa data.fa --model GTR --tree pars{50} --race 10 --race-keep 5";
+  parse_options(cmd, parser, options, false);
+  EXPECT_EQ(10., options.race_lh_diff);
+  EXPECT_EQ(5, options.race_keep);
+
+  cmd = "raxml-ng --msa data.fa --model GTR --tree pars{50} --race auto";
+  parse_options(cmd, parser, options, false);
+  EXPECT_LT(options.race_lh_diff, 0.);
+
+  // wrong: negative logLH difference
+  cmd = "raxml-ng --msa data.fa --model GTR --race -5";
+  parse_options(cmd, parser, options, true);
+}
+
+TEST(CommandLineParserTest, search_pin)
+{
+  // buildup
+  CommandLineParser parser;
+  Options options;
+
+  // default: no thread pinning
+  string cmd = "raxml-ng --msa data.fa --model GTR";
+  parse_options(cmd, parser, options, false);
+  EXPECT_EQ(PinMode::none, options.pin_mode);
+
+  cmd = "raxml-ng --msa data.fa --model GTR --threads 4 --pin scatter";
+  parse_options(cmd, parser, options, false);
+  EXPECT_EQ(PinMode::scatter, options.pin_mode);
+
+  cmd = "raxml-ng --msa data.fa --model GTR --threads 4 --pin numa";
+  parse_options(cmd, parser, options, false);
+  EXPECT_EQ(PinMode::numa, options.pin_mode);
+
+  cmd = "raxml-ng --msa data.fa --model GTR --threads 4 --pin off";
+  parse_options(cmd, parser, options, false);
+  EXPECT_EQ(PinMode::none, options.pin_mode);
+
+  // wrong: unknown pinning mode
+  cmd = "raxml-ng --msa data.fa --model GTR --pin cores";
+  parse_options(cmd, parser, options, true);
+}
+
+TEST(CommandLineParserTest, search_mpi_threads)
+{
+  // buildup
+  CommandLineParser parser;
+  Options options;
+
+  // default: only thread 0 talks to MPI
+  string cmd = "raxml-ng --msa data.fa --model GTR";
+  parse_options(cmd, parser, options, false);
+  EXPECT_FALSE(options.mpi_thread_multiple);
+
+  cmd = "raxml-ng --msa data.fa --model GTR --threads 4 --mpi-threads multiple";
+  parse_options(cmd, parser, options, false);
+  EXPECT_TRUE(options.mpi_thread_multiple);
+
+  cmd = "raxml-ng --msa data.fa --model GTR --threads 4 --mpi-threads funneled";
+  parse_options(cmd, parser, options, false);
+  EXPECT_FALSE(options.mpi_thread_multiple);
+
+  // wrong: unknown MPI threading mode
+  cmd = "raxml-ng --msa data.fa --model GTR --mpi-threads serialized";
+  parse_options(cmd, parser, options, true);
+}
+
+TEST(CommandLineParserTest, all_bs_queue)
+{
+  // buildup
+  CommandLineParser parser;
+  Options options;
+
+  // default: all MPI ranks work on the same bootstrap replicate
+  string cmd = "raxml-ng --all --msa data.fa --model GTR";
+  parse_options(cmd, parser, options, false);
+  EXPECT_FALSE(options.mpi_bs_queue);
+
+  cmd = "raxml-ng --all --msa data.fa --model GTR --bs-queue on";
+  parse_options(cmd, parser, options, false);
+  EXPECT_TRUE(options.mpi_bs_queue);
+
+  cmd = "raxml-ng --all --msa data.fa --model GTR --bs-queue off";
+  parse_options(cmd, parser, options, false);
+  EXPECT_FALSE(options.mpi_bs_queue);
+}
+
+TEST(CommandLineParserTest, search_clv_tasks)
+{
+  // buildup
+  CommandLineParser parser;
+  Options options;
+
+  // default: data decomposition only
+  string cmd = "raxml-ng --msa data.fa --model GTR";
+  parse_options(cmd, parser, options, false);
+  EXPECT_EQ(1, options.clv_task_threads);
+
+  cmd = "raxml-ng --msa data.fa --model GTR --threads 8 --workers 2 --clv-tasks 2";
+  parse_options(cmd, parser, options, false);
+  EXPECT_EQ(2, options.clv_task_threads);
+
+  // wrong: #threads per worker is not a multiple of the team size
+  cmd = "raxml-ng --msa data.fa --model GTR --threads 8 --workers 4 --clv-tasks 4";
+  parse_options(cmd, parser, options, true);
+
+  // wrong: zero threads
+  cmd = "raxml-ng --msa data.fa --model GTR --clv-tasks 0";
+  parse_options(cmd, parser, options, true);
+}
+
+TEST(CommandLineParserTest, search_rebalance)
+{
+  // buildup
+  CommandLineParser parser;
+  Options options;
+
+  // default: static load balancing only
+  string cmd = "raxml-ng --msa data.fa --model GTR";
+  parse_options(cmd, parser, options, false);
+  EXPECT_EQ(0., options.rebalance_threshold);
+
+  cmd = "raxml-ng --msa data.fa --model GTR --threads 4 --rebalance 1.2";
+  parse_options(cmd, parser, options, false);
+  EXPECT_EQ(1.2, options.rebalance_threshold);
+
+  cmd = "raxml-ng --msa data.fa --model GTR --threads 4 --rebalance off";
+  parse_options(cmd, parser, options, false);
+  EXPECT_EQ(0., options.rebalance_threshold);
+
+  // wrong: imbalance threshold below 1
+  cmd = "raxml-ng --msa data.fa --model GTR --rebalance 0.5";
+  parse_options(cmd, parser, options, true);
+}
+
+TEST(CommandLineParserTest, search_load_balancer)
+{
+  // buildup
+  CommandLineParser parser;
+  Options options;
+
+  string cmd = "raxml-ng --msa data.fa --model GTR";
+  parse_options(cmd, parser, options, false);
+  EXPECT_EQ(LoadBalancerType::kassian, options.load_balancer);
+
+  cmd = "raxml-ng --msa data.fa --model GTR --threads 4 --load-balancer makespan";
+  parse_options(cmd, parser, options, false);
+  EXPECT_EQ(LoadBalancerType::makespan, options.load_balancer);
+
+  cmd = "raxml-ng --msa data.fa --model GTR --threads 4 --load-balancer simple";
+  parse_options(cmd, parser, options, false);
+  EXPECT_EQ(LoadBalancerType::simple, options.load_balancer);
+
+  // wrong: unknown load balancer
+  cmd = "raxml-ng --msa data.fa --model GTR --load-balancer greedy";
+  parse_options(cmd, parser, options, true);
+}
+
+TEST(CommandLineParserTest, balance_only)
+{
+  // buildup
+  CommandLineParser parser;
+  Options options;
+
+  string cmd = "raxml-ng --balance-only --msa data.fa --model GTR --threads 8 --ranks 16";
+  parse_options(cmd, parser, options, false);
+  EXPECT_EQ(Command::balance, options.command);
+  EXPECT_EQ(8, options.num_threads);
+  EXPECT_EQ(16, options.num_ranks);
+
+  // wrong: --ranks is only used for planning
+  cmd = "raxml-ng --msa data.fa --model GTR --ranks 16";
+  parse_options(cmd, parser, options, true);
+
+  // wrong: zero ranks
+  cmd = "raxml-ng --balance-only --msa data.fa --model GTR --ranks 0";
+  parse_options(cmd, parser, options, true);
+
+  // wrong: alignment missing
+  Options options2;
+  cmd = "raxml-ng --balance-only --model GTR";
+  parse_options(cmd, parser, options2, true);
+}
+
+TEST(CommandLineParserTest, search_spr_converge)
+{
+  // buildup
+  CommandLineParser parser;
+  Options options;
+
+  // default: off
+  string cmd = "raxml-ng --msa data.fa --model GTR";
+  parse_options(cmd, parser, options, false);
+  EXPECT_EQ(0, options.spr_converge);
+
+  cmd = "raxml-ng --msa data.fa --model GTR --spr-converge 3";
+  parse_options(cmd, parser, options, false);
+  EXPECT_EQ(3, options.spr_converge);
+
+  cmd = "raxml-ng --msa data.fa --model GTR --spr-converge off";
+  parse_options(cmd, parser, options, false);
+  EXPECT_EQ(0, options.spr_converge);
+
+  // wrong: zero SPR rounds
+  cmd = "raxml-ng --msa data.fa --model GTR --spr-converge 0";
+  parse_options(cmd, parser, options, true);
+}
+
+TEST(CommandLineParserTest, search_spr_memo)
+{
+  // buildup
+  CommandLineParser parser;
+  Options options;
+
+  // default: off
+  string cmd = "raxml-ng --msa data.fa --model GTR";
+  parse_options(cmd, parser, options, false);
+  EXPECT_FALSE(options.spr_memo);
+
+  cmd = "raxml-ng --msa data.fa --model GTR --threads 4 --spr-memo on";
+  parse_options(cmd, parser, options, false);
+  EXPECT_TRUE(options.spr_memo);
+
+  cmd = "raxml-ng --msa data.fa --model GTR --threads 4 --spr-memo off";
+  parse_options(cmd, parser, options, false);
+  EXPECT_FALSE(options.spr_memo);
+}
+
+TEST(CommandLineParserTest, search_adaptive_modopt)
+{
+  // buildup
+  CommandLineParser parser;
+  Options options;
+
+  // default: off
+  string cmd = "raxml-ng --msa data.fa --model GTR";
+  parse_options(cmd, parser, options, false);
+  EXPECT_FALSE(options.adaptive_modopt);
+
+  cmd = "raxml-ng --msa data.fa --model GTR --adaptive-modopt on";
+  parse_options(cmd, parser, options, false);
+  EXPECT_TRUE(options.adaptive_modopt);
+
+  cmd = "raxml-ng --msa data.fa --model GTR --adaptive-modopt off";
+  parse_options(cmd, parser, options, false);
+  EXPECT_FALSE(options.adaptive_modopt);
+}
+
 TEST(CommandLineParserTest, eval_wrong)
 {
   // buildup
@@ -0,0 +1,256 @@
+#include "RaxmlTest.hpp"
+
+#include <random>
+
+#include "src/LoadBalancer.hpp"
+
+using namespace std;
+
+/* every site of every partition must be assigned to exactly one thread, and a thread
+ * can hold at most one (contiguous) range per partition */
+static void check_assignments(const PartitionAssignment& part_sizes,
+                              const PartitionAssignmentList& part_assign)
+{
+  for (auto const& full_range: part_sizes)
+  {
+    vector<unsigned int> covered(full_range.length, 0);
+    for (auto const& pa: part_assign)
+    {
+      size_t count = 0;
+      for (auto const& range: pa)
+      {
+        if (range.part_id != full_range.part_id)
+          continue;
+
+        count++;
+        ASSERT_GT(range.length, 0);
+        ASSERT_LE(range.start + range.length, full_range.start + full_range.length);
+        for (size_t i = range.start; i < range.start + range.length; ++i)
+          covered.at(i - full_range.start)++;
+      }
+      EXPECT_LE(count, 1) << "partition " << full_range.part_id << " assigned twice to a thread";
+    }
+
+    for (auto c: covered)
+      ASSERT_EQ(c, 1) << "partition " << full_range.part_id;
+  }
+}
+
+static size_t num_slices(const PartitionAssignmentList& part_assign)
+{
+  size_t count = 0;
+  for (auto const& pa: part_assign)
+    count += pa.num_parts();
+  return count;
+}
+
+static PartitionAssignment random_part_sizes(size_t num_parts, size_t min_len, size_t max_len,
+                                             unsigned int seed, bool mixed_cost = false)
+{
+  std::mt19937 gen(seed);
+  std::uniform_int_distribution<size_t> len_dist(min_len, max_len);
+  PartitionAssignment part_sizes;
+  for (size_t i = 0; i < num_parts; ++i)
+  {
+    /* DNA+G4 vs. protein+G4 (per-site cost ~ states^2 x rate categories) */
+    const double site_cost = mixed_cost && (i % 3 == 0) ? 1600. : 64.;
+    part_sizes.assign_sites(i, 0, len_dist(gen), site_cost);
+  }
+  return part_sizes;
+}
+
+TEST(LoadBalancerTest, create)
+{
+  EXPECT_NE(dynamic_cast<SimpleLoadBalancer*>(LoadBalancer::create(LoadBalancerType::simple).get()),
+            nullptr);
+  EXPECT_NE(dynamic_cast<KassianLoadBalancer*>(LoadBalancer::create(LoadBalancerType::kassian).get()),
+            nullptr);
+  EXPECT_NE(dynamic_cast<MakespanLoadBalancer*>(LoadBalancer::create(LoadBalancerType::makespan).get()),
+            nullptr);
+}
+
+TEST(LoadBalancerTest, single_proc)
+{
+  auto part_sizes = random_part_sizes(10, 1, 1000, 1);
+
+  for (auto type: {LoadBalancerType::simple, LoadBalancerType::kassian, LoadBalancerType::makespan})
+  {
+    auto part_assign = LoadBalancer::create(type)->get_all_assignments(part_sizes, 1);
+    ASSERT_EQ(part_assign.size(), 1);
+    EXPECT_EQ(part_assign[0].num_parts(), 10);
+    check_assignments(part_sizes, part_assign);
+  }
+}
+
+TEST(LoadBalancerTest, coverage)
+{
+  for (unsigned int seed = 0; seed < 20; ++seed)
+  {
+    auto part_sizes = random_part_sizes(1 + seed % 7, 100, 5000, seed, seed % 2);
+    const size_t num_procs = 2 + seed % 15;
+
+    for (auto type: {LoadBalancerType::simple, LoadBalancerType::kassian,
+                     LoadBalancerType::makespan})
+    {
+      auto part_assign = LoadBalancer::create(type)->get_all_assignments(part_sizes, num_procs);
+      ASSERT_EQ(part_assign.size(), num_procs);
+      SCOPED_TRACE(load_balancer_name(type) + ", seed " + to_string(seed));
+      check_assignments(part_sizes, part_assign);
+    }
+  }
+}
+
+TEST(LoadBalancerTest, kassian_cost_weights)
+{
+  /* same number of sites, but the second partition is 25x more expensive */
+  PartitionAssignment part_sizes;
+  part_sizes.assign_sites(0, 0, 10000, 64.);
+  part_sizes.assign_sites(1, 0, 10000, 1600.);
+
+  KassianLoadBalancer balancer;
+  auto part_assign = balancer.get_all_assignments(part_sizes, 4);
+  check_assignments(part_sizes, part_assign);
+
+  PartitionAssignmentStats stats(part_assign);
+  EXPECT_LT(stats.imbalance(), 1.01);
+  EXPECT_GT(stats.max_thread_sites, 2 * stats.min_thread_sites);
+}
+
+TEST(LoadBalancerTest, makespan_many_small_partitions)
+{
+  /* many small partitions: should be assigned as a whole */
+  auto part_sizes = random_part_sizes(2000, 10, 300, 42);
+  const size_t num_procs = 16;
+
+  MakespanLoadBalancer makespan_balancer;
+  auto part_assign = makespan_balancer.get_all_assignments(part_sizes, num_procs);
+  check_assignments(part_sizes, part_assign);
+
+  EXPECT_LE(num_slices(part_assign), part_sizes.num_parts() + num_procs);
+  EXPECT_LT(PartitionAssignmentStats(part_assign).imbalance(), 1.02);
+
+  /* per-slice overhead: makespan must not be worse than with Kassian */
+  KassianLoadBalancer kassian_balancer;
+  auto kassian_assign = kassian_balancer.get_all_assignments(part_sizes, num_procs);
+  EXPECT_LE(makespan_balancer.makespan(part_assign),
+            makespan_balancer.makespan(kassian_assign) * 1.001);
+}
+
+TEST(LoadBalancerTest, makespan_one_large_partition)
+{
+  /* one huge partition and a few tiny ones: the large one must be split */
+  PartitionAssignment part_sizes;
+  part_sizes.assign_sites(0, 0, 100000, 64.);
+  for (size_t i = 1; i < 5; ++i)
+    part_sizes.assign_sites(i, 0, 50, 64.);
+
+  const size_t num_procs = 8;
+  MakespanLoadBalancer balancer;
+  auto part_assign = balancer.get_all_assignments(part_sizes, num_procs);
+  check_assignments(part_sizes, part_assign);
+
+  for (auto const& pa: part_assign)
+    EXPECT_NE(pa.find(0), pa.end());
+
+  EXPECT_LT(PartitionAssignmentStats(part_assign).imbalance(), 1.01);
+}
+
+TEST(LoadBalancerTest, makespan_mixed_costs)
+{
+  for (unsigned int seed = 0; seed < 10; ++seed)
+  {
+    auto part_sizes = random_part_sizes(50, 100, 20000, seed, true);
+    const size_t num_procs = 12;
+
+    MakespanLoadBalancer balancer;
+    auto part_assign = balancer.get_all_assignments(part_sizes, num_procs);
+    check_assignments(part_sizes, part_assign);
+
+    /* lower bound: average load incl. one overhead term per partition */
+    double total = 0.;
+    for (auto const& range: part_sizes)
+      total += range.cost() + range.site_cost * balancer.slice_overhead();
+
+    EXPECT_LT(balancer.makespan(part_assign), 1.02 * total / num_procs) << "seed " << seed;
+  }
+}
+
+TEST(LoadBalancerTest, makespan_more_procs_than_sites)
+{
+  PartitionAssignment part_sizes;
+  part_sizes.assign_sites(0, 0, 3, 1.);
+  part_sizes.assign_sites(1, 0, 2, 1.);
+
+  MakespanLoadBalancer balancer;
+  auto part_assign = balancer.get_all_assignments(part_sizes, 8);
+  ASSERT_EQ(part_assign.size(), 8);
+  check_assignments(part_sizes, part_assign);
+}
+
+TEST(LoadBalancerTest, capacities_coverage)
+{
+  for (unsigned int seed = 0; seed < 20; ++seed)
+  {
+    auto part_sizes = random_part_sizes(1 + seed % 7, 100, 5000, seed, seed % 2);
+    const size_t num_procs = 2 + seed % 15;
+
+    std::mt19937 gen(seed);
+    std::uniform_real_distribution<double> cap_dist(0.3, 1.5);
+    vector<double> capacities(num_procs);
+    for (auto& c: capacities)
+      c = cap_dist(gen);
+
+    for (auto type: {LoadBalancerType::simple, LoadBalancerType::kassian,
+                     LoadBalancerType::makespan})
+    {
+      auto balancer = LoadBalancer::create(type);
+      balancer->capacities(capacities);
+      auto part_assign = balancer->get_all_assignments(part_sizes, num_procs);
+      ASSERT_EQ(part_assign.size(), num_procs);
+      SCOPED_TRACE(load_balancer_name(type) + ", seed " + to_string(seed));
+      check_assignments(part_sizes, part_assign);
+    }
+  }
+}
+
+TEST(LoadBalancerTest, capacities_proportional)
+{
+  /* two fast cores and four slow ones (e.g. big.LITTLE) */
+  const vector<double> capacities = {2., 2., 1., 1., 1., 1.};
+  auto part_sizes = random_part_sizes(20, 1000, 10000, 7, true);
+
+  for (auto type: {LoadBalancerType::simple, LoadBalancerType::kassian,
+                   LoadBalancerType::makespan})
+  {
+    auto balancer = LoadBalancer::create(type);
+    balancer->capacities(capacities);
+    auto part_assign = balancer->get_all_assignments(part_sizes, capacities.size());
+    SCOPED_TRACE(load_balancer_name(type));
+    check_assignments(part_sizes, part_assign);
+
+    EXPECT_LT(estimated_imbalance(part_assign, capacities), 1.02);
+    EXPECT_GT(part_assign[0].cost(), 1.9 * part_assign[5].cost());
+  }
+
+  /* one capacity value per thread */
+  auto balancer = LoadBalancer::create(LoadBalancerType::kassian);
+  balancer->capacities(capacities);
+  EXPECT_THROW(balancer->get_all_assignments(part_sizes, 4), runtime_error);
+}
+
+TEST(LoadBalancerTest, calibrate_capacities)
+{
+  PartitionAssignment part_sizes;
+  part_sizes.assign_sites(0, 0, 1000, 1.);
+  part_sizes.assign_sites(1, 0, 1000, 1.);
+
+  /* partition 1 is 3x more expensive than estimated, thread 0 is 2x faster */
+  PartitionAssignmentList part_assign(2);
+  part_assign[0].assign_sites(0, 0, 1000, 1.);
+  part_assign[1].assign_sites(1, 0, 1000, 1.);
+  const vector<double> capacities = {2., 1.};
+  const vector<double> times = {1000. / 2., 3000.};
+
+  auto new_sizes = calibrate_site_costs(part_sizes, part_assign, times, capacities);
+  EXPECT_NEAR(new_sizes[1].site_cost / new_sizes[0].site_cost, 3., 1e-9);
+}
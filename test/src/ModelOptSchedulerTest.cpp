@@ -0,0 +1,58 @@
+#include "RaxmlTest.hpp"
+
+#include "src/ModelOptScheduler.hpp"
+
+using namespace std;
+
+TEST(ModelOptSchedulerTest, disabled)
+{
+  ModelOptScheduler sched;
+  EXPECT_FALSE(sched.enabled());
+
+  // nothing is ever skipped
+  sched.update(0, PLLMOD_OPT_PARAM_ALPHA, 0., 0., 0.1);
+  EXPECT_FALSE(sched.converged(0, PLLMOD_OPT_PARAM_ALPHA));
+}
+
+TEST(ModelOptSchedulerTest, converged)
+{
+  ModelOptScheduler sched(true);
+  const double eps = 0.1;
+  EXPECT_TRUE(sched.enabled());
+  EXPECT_FALSE(sched.converged(0, PLLMOD_OPT_PARAM_ALPHA));
+
+  // small change of the parameter values
+  sched.update(0, PLLMOD_OPT_PARAM_ALPHA, RAXML_MODOPT_MIN_CHANGE / 2, 10., eps);
+  EXPECT_TRUE(sched.converged(0, PLLMOD_OPT_PARAM_ALPHA));
+
+  // small logLH gain
+  sched.update(1, PLLMOD_OPT_PARAM_ALPHA, 1., RAXML_MODOPT_MIN_GAIN * eps / 2, eps);
+  EXPECT_TRUE(sched.converged(1, PLLMOD_OPT_PARAM_ALPHA));
+
+  // still changing
+  sched.update(2, PLLMOD_OPT_PARAM_ALPHA, 1., 10., eps);
+  EXPECT_FALSE(sched.converged(2, PLLMOD_OPT_PARAM_ALPHA));
+
+  // parameter classes and partitions are independent
+  EXPECT_FALSE(sched.converged(0, PLLMOD_OPT_PARAM_SUBST_RATES));
+  EXPECT_FALSE(sched.converged(5, PLLMOD_OPT_PARAM_ALPHA));
+
+  // not converged anymore
+  sched.update(0, PLLMOD_OPT_PARAM_ALPHA, 1., 10., eps);
+  EXPECT_FALSE(sched.converged(0, PLLMOD_OPT_PARAM_ALPHA));
+
+  sched.reset();
+  EXPECT_FALSE(sched.converged(1, PLLMOD_OPT_PARAM_ALPHA));
+}
+
+TEST(ModelOptSchedulerTest, param_change)
+{
+  EXPECT_DOUBLE_EQ(0., ModelOptScheduler::param_change({1., 2.}, {1., 2.}));
+
+  // largest relative difference
+  EXPECT_DOUBLE_EQ(0.5, ModelOptScheduler::param_change({1., 2.}, {1.1, 3.}));
+  EXPECT_DOUBLE_EQ(0.5, ModelOptScheduler::param_change({2., 4.}, {1., 4.}));
+
+  // zero must not lead to division by zero
+  EXPECT_GT(ModelOptScheduler::param_change({0.}, {1.}), 1.);
+}
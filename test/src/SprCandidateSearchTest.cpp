@@ -0,0 +1,126 @@
+#include "RaxmlTest.hpp"
+
+#include "src/SprCandidateSearch.hpp"
+
+using namespace std;
+
+/* unrooted tree with 6 tips around a central node: ((0,1)x,(2,3)y,(4,5)z)c,
+ * tips have node indices 0-5, inner nodes 6 and up */
+class SprTestTree
+{
+public:
+  SprTestTree() : _nodes(18)
+  {
+    for (size_t i = 0; i < _nodes.size(); ++i)
+    {
+      _nodes[i].node_index = (unsigned int) i;
+      _nodes[i].next = nullptr;
+      _nodes[i].back = nullptr;
+    }
+
+    for (size_t i = 0; i < 4; ++i)
+    {
+      pll_unode_t * n = inner(i);
+      n[0].next = &n[1];
+      n[1].next = &n[2];
+      n[2].next = &n[0];
+    }
+
+    for (size_t i = 0; i < 3; ++i)
+    {
+      link(&inner(3)[i], &inner(i)[0]);
+      link(&inner(i)[1], &_nodes[2 * i]);
+      link(&inner(i)[2], &_nodes[2 * i + 1]);
+    }
+  }
+
+  /* inner nodes x, y, z, c (3 unodes each) */
+  pll_unode_t * inner(size_t i) { return &_nodes[6 + 3 * i]; }
+  pll_unode_t * tip(size_t i) { return &_nodes[i]; }
+
+  /* exchange the subtrees behind a and b */
+  void swap(pll_unode_t * a, pll_unode_t * b)
+  {
+    pll_unode_t * a_back = a->back;
+    pll_unode_t * b_back = b->back;
+    link(a, b_back);
+    link(b, a_back);
+  }
+
+private:
+  vector<pll_unode_t> _nodes;
+
+  static void link(pll_unode_t * a, pll_unode_t * b)
+  {
+    a->back = b;
+    b->back = a;
+  }
+};
+
+TEST(SprCandidateSearchTest, topology_hash)
+{
+  SprTestTree tree;
+  pll_unode_t * p = tree.inner(0);
+
+  const auto hash1 = spr_topology_hash(p, 1);
+  const auto hash2 = spr_topology_hash(p, 2);
+  EXPECT_EQ(hash1, spr_topology_hash(p, 1));
+  EXPECT_NE(hash1, hash2);
+
+  // NNI around the edge between y and z: beyond radius 1, but within radius 2
+  tree.swap(&tree.inner(1)[2], &tree.inner(2)[1]);
+  EXPECT_EQ(hash1, spr_topology_hash(p, 1));
+  EXPECT_NE(hash2, spr_topology_hash(p, 2));
+
+  // and back again
+  tree.swap(&tree.inner(1)[2], &tree.inner(2)[1]);
+  EXPECT_EQ(hash2, spr_topology_hash(p, 2));
+
+  // NNI right next to p
+  tree.swap(&tree.inner(0)[1], &tree.inner(1)[1]);
+  EXPECT_NE(hash1, spr_topology_hash(p, 1));
+}
+
+TEST(SprCandidateSearchTest, memo)
+{
+  SprCandidateSearch search;
+  search.reset(10, 6, true);
+
+  const SprMemoEntry entry = {12345, 1, 5, false};
+  EXPECT_FALSE(search.memo_hit(3, entry));
+
+  search.memo_store(3, entry);
+  EXPECT_TRUE(search.memo_hit(3, entry));
+  EXPECT_FALSE(search.memo_hit(4, entry));
+
+  // any difference in topology or radius window invalidates the record
+  EXPECT_FALSE(search.memo_hit(3, {12346, 1, 5, false}));
+  EXPECT_FALSE(search.memo_hit(3, {12345, 1, 10, false}));
+  EXPECT_FALSE(search.memo_hit(3, {12345, 1, 5, true}));
+
+  // memo survives a new round, unless requested otherwise
+  search.reset(10, 6, false);
+  EXPECT_TRUE(search.memo_hit(3, entry));
+  search.reset(10, 6, true);
+  EXPECT_FALSE(search.memo_hit(3, entry));
+
+  search.memo_store(3, entry);
+  search.memo_clear(3);
+  EXPECT_FALSE(search.memo_hit(3, entry));
+}
+
+TEST(SprCandidateSearchTest, best_moves)
+{
+  SprMoveList moves;
+  moves.reset(2);
+  moves.insert({-100., 1, 2});
+  moves.insert({-90., 3, 4});
+  moves.insert({-95., 5, 6});
+  moves.insert({-90., 2, 7});
+
+  // best first, ties broken by node indices
+  auto best = moves.sorted();
+  ASSERT_EQ(2, best.size());
+  EXPECT_EQ(2, best[0].prune_index);
+  EXPECT_EQ(3, best[1].prune_index);
+}
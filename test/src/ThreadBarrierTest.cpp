@@ -0,0 +1,79 @@
+#include "RaxmlTest.hpp"
+
+#include <thread>
+
+#include "src/ThreadBarrier.hpp"
+
+using namespace std;
+
+/* every thread increments a shared counter once per round: after the barrier, all threads
+ * must see the increments of all other threads, and nobody may run ahead */
+static void check_barrier(size_t num_threads, BarrierMode mode, size_t spin_count)
+{
+  const size_t num_rounds = 200;
+  ThreadBarrier barrier(num_threads, mode, spin_count);
+  atomic<size_t> counter(0);
+  atomic<size_t> errors(0);
+
+  auto thread_main = [&]()
+    {
+      for (size_t r = 0; r < num_rounds; ++r)
+      {
+        counter++;
+        barrier.wait();
+        if (counter.load() != (r + 1) * num_threads)
+          errors++;
+        barrier.wait();
+      }
+    };
+
+  vector<thread> threads;
+  for (size_t i = 1; i < num_threads; ++i)
+    threads.emplace_back(thread_main);
+  thread_main();
+  for (auto& t: threads)
+    t.join();
+
+  EXPECT_EQ(0, errors.load());
+  EXPECT_EQ(num_rounds * num_threads, counter.load());
+}
+
+TEST(ThreadBarrierTest, spin)
+{
+  check_barrier(4, BarrierMode::spin, RAXML_BARRIER_SPIN_COUNT);
+}
+
+TEST(ThreadBarrierTest, adaptive)
+{
+  check_barrier(4, BarrierMode::adaptive, RAXML_BARRIER_SPIN_COUNT);
+
+  // no spinning at all -> threads go to sleep right away
+  check_barrier(4, BarrierMode::adaptive, 0);
+}
+
+TEST(ThreadBarrierTest, block)
+{
+  check_barrier(4, BarrierMode::block, RAXML_BARRIER_SPIN_COUNT);
+}
+
+TEST(ThreadBarrierTest, single_thread)
+{
+  // must not block
+  ThreadBarrier barrier(1, BarrierMode::block);
+  barrier.wait();
+  barrier.wait();
+  EXPECT_EQ(1, barrier.num_threads());
+}
+
+TEST(ThreadBarrierTest, reset)
+{
+  ThreadBarrier barrier(2, BarrierMode::spin);
+  EXPECT_EQ(2, barrier.num_threads());
+  EXPECT_EQ(BarrierMode::spin, barrier.mode());
+
+  barrier.reset(3, BarrierMode::block);
+  EXPECT_EQ(3, barrier.num_threads());
+  EXPECT_EQ(BarrierMode::block, barrier.mode());
+
+  check_barrier(3, BarrierMode::block, 0);
+}
@@ -0,0 +1,86 @@
+#include "RaxmlTest.hpp"
+
+#include "src/ThreadPinning.hpp"
+
+using namespace std;
+
+/* nodes x sockets per node x cores per socket x hardware threads per core; CPU ids are assigned
+ * like in Linux: all physical cores first, then their second hardware threads etc. */
+static CpuTopology make_topology(int nodes, int sockets, int cores, int smt)
+{
+  vector<LogicalCpu> cpus;
+  const int num_cores = nodes * sockets * cores;
+  for (int t = 0; t < smt; ++t)
+  {
+    for (int c = 0; c < num_cores; ++c)
+    {
+      LogicalCpu cpu;
+      cpu.id = t * num_cores + c;
+      cpu.core_id = c % cores;
+      cpu.socket_id = c / cores;
+      cpu.node_id = c / (sockets * cores);
+      cpu.smt_id = t;
+      cpus.push_back(cpu);
+    }
+  }
+  return CpuTopology(cpus);
+}
+
+TEST(ThreadPinningTest, topology)
+{
+  auto topo = make_topology(2, 1, 4, 2);
+  EXPECT_EQ(16, topo.num_cpus());
+  EXPECT_EQ(8, topo.num_cores());
+  EXPECT_EQ(2, topo.num_sockets());
+  EXPECT_EQ(2, topo.num_nodes());
+  EXPECT_EQ(1, topo.cpu(13).smt_id);
+  EXPECT_EQ(1, topo.cpu(13).node_id);
+}
+
+TEST(ThreadPinningTest, none)
+{
+  auto topo = make_topology(1, 1, 4, 1);
+  EXPECT_TRUE(compute_thread_cpus(topo, PinMode::none, 4, 1).empty());
+  EXPECT_TRUE(compute_thread_cpus(CpuTopology(vector<LogicalCpu>()), PinMode::compact,
+                                  4, 1).empty());
+}
+
+TEST(ThreadPinningTest, compact)
+{
+  // physical cores first, hyperthreads last
+  auto topo = make_topology(1, 2, 2, 2);
+  EXPECT_EQ(vector<int>({0, 1, 2, 3, 4, 5}), compute_thread_cpus(topo, PinMode::compact, 6, 1));
+
+  // more threads than CPUs: wrap around
+  EXPECT_EQ(vector<int>({0, 1, 2, 3, 4, 5, 6, 7, 0, 1}),
+            compute_thread_cpus(topo, PinMode::compact, 10, 1));
+}
+
+TEST(ThreadPinningTest, scatter)
+{
+  // one core from each socket in turn
+  auto topo = make_topology(1, 2, 2, 2);
+  EXPECT_EQ(vector<int>({0, 2, 1, 3, 4, 6}), compute_thread_cpus(topo, PinMode::scatter, 6, 1));
+}
+
+TEST(ThreadPinningTest, numa)
+{
+  auto topo = make_topology(2, 1, 4, 1);
+
+  // enough groups: every group on a single node
+  EXPECT_EQ(vector<int>({0, 1, 4, 5}), compute_thread_cpus(topo, PinMode::numa, 4, 2));
+
+  // single group: contiguous blocks spread across nodes
+  EXPECT_EQ(vector<int>({0, 1, 4, 5}), compute_thread_cpus(topo, PinMode::numa, 4, 1));
+}
+
+TEST(ThreadPinningTest, node_ranks)
+{
+  // ranks sharing a node get disjoint blocks of physical cores, incl. their hyperthreads
+  auto topo = make_topology(1, 2, 2, 2);
+  EXPECT_EQ(vector<int>({0, 1, 4, 5}), compute_thread_cpus(topo, PinMode::compact, 4, 1, 0, 2));
+  EXPECT_EQ(vector<int>({2, 3, 6, 7}), compute_thread_cpus(topo, PinMode::compact, 4, 1, 1, 2));
+
+  // more ranks than cores
+  EXPECT_EQ(vector<int>({1, 5}), compute_thread_cpus(topo, PinMode::compact, 2, 1, 5, 6));
+}
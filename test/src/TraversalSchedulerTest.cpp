@@ -0,0 +1,102 @@
+#include "RaxmlTest.hpp"
+
+#include <thread>
+
+#include "src/TraversalScheduler.hpp"
+
+using namespace std;
+
+static pll_operation_t make_op(unsigned int parent, unsigned int child1, unsigned int child2)
+{
+  pll_operation_t op;
+  op.parent_clv_index = parent;
+  op.child1_clv_index = child1;
+  op.child2_clv_index = child2;
+  return op;
+}
+
+/* post-order traversal of ((0,1),(2,3)),(4,5): CLVs 0-5 are tips */
+static vector<pll_operation_t> balanced_ops()
+{
+  return {make_op(6, 0, 1), make_op(7, 2, 3), make_op(8, 6, 7), make_op(9, 4, 5),
+          make_op(10, 8, 9)};
+}
+
+TEST(TraversalSchedulerTest, dag_balanced)
+{
+  auto ops = balanced_ops();
+
+  TraversalDAG dag;
+  dag.build(ops.data(), ops.size());
+
+  ASSERT_EQ(5, dag.size());
+  EXPECT_EQ(vector<unsigned int>({0, 1, 3}), dag.ready());
+
+  EXPECT_EQ(2, dag.parent(0));
+  EXPECT_EQ(2, dag.parent(1));
+  EXPECT_EQ(4, dag.parent(2));
+  EXPECT_EQ(4, dag.parent(3));
+  EXPECT_EQ(-1, dag.parent(4));
+
+  EXPECT_EQ(0, dag.num_deps(0));
+  EXPECT_EQ(2, dag.num_deps(2));
+  EXPECT_EQ(0, dag.num_deps(3));
+  EXPECT_EQ(2, dag.num_deps(4));
+}
+
+TEST(TraversalSchedulerTest, dag_partial)
+{
+  // partial traversal: CLVs 6 and 7 are still valid and thus not recomputed
+  vector<pll_operation_t> ops = {make_op(8, 6, 7), make_op(9, 4, 8)};
+
+  TraversalDAG dag;
+  dag.build(ops.data(), ops.size());
+
+  ASSERT_EQ(2, dag.size());
+  EXPECT_EQ(vector<unsigned int>({0}), dag.ready());
+  EXPECT_EQ(1, dag.parent(0));
+  EXPECT_EQ(1, dag.num_deps(1));
+
+  // rebuild with a different traversal
+  auto balanced = balanced_ops();
+  dag.build(balanced.data(), balanced.size());
+  EXPECT_EQ(5, dag.size());
+  EXPECT_EQ(3, dag.ready().size());
+}
+
+TEST(TraversalSchedulerTest, teams)
+{
+  TraversalScheduler::init_teams(4, 2, BarrierMode::adaptive);
+  ASSERT_NE(nullptr, TraversalScheduler::team(0));
+  EXPECT_EQ(TraversalScheduler::team(0), TraversalScheduler::team(1));
+  EXPECT_NE(TraversalScheduler::team(1), TraversalScheduler::team(2));
+  EXPECT_EQ(0, TraversalScheduler::team_member(2));
+  EXPECT_EQ(1, TraversalScheduler::team_member(3));
+  EXPECT_EQ(2, TraversalScheduler::team(3)->team_size());
+
+  // team size 1: disabled
+  TraversalScheduler::init_teams(4, 1, BarrierMode::adaptive);
+  EXPECT_EQ(nullptr, TraversalScheduler::team(0));
+}
+
+TEST(TraversalSchedulerTest, execute)
+{
+  // no partitions, so only the task bookkeeping is exercised: all members must return
+  auto ops = balanced_ops();
+  for (auto mode: {BarrierMode::spin, BarrierMode::adaptive, BarrierMode::block})
+  {
+    TraversalScheduler scheduler(3, mode);
+    for (size_t r = 0; r < 20; ++r)
+    {
+      vector<thread> members;
+      for (size_t m = 1; m < 3; ++m)
+        members.emplace_back([&scheduler, m]() { scheduler.execute(m); });
+
+      scheduler.prepare(ops.data(), ops.size(), vector<pll_partition_t*>());
+      scheduler.execute(0);
+
+      for (auto& t: members)
+        t.join();
+    }
+  }
+}